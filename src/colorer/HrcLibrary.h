@@ -7,6 +7,9 @@
 #include "colorer/common/spimpl.h"
 #include "colorer/xml/XmlInputSource.h"
 
+class CRegExp;
+class LineSource;
+
 /** Informs application about internal HRC parsing problems.
     @ingroup colorer
 */
@@ -55,6 +58,12 @@ class HrcLibrary
   */
   FileType* chooseFileType(const UnicodeString* fileName, const UnicodeString* firstLine, int typeNo = 0);
 
+  /** Searches and returns the best type for the file by its name and the start of its text.
+      @param filePath Path of file, only the name is used; could be null
+      @param lineSource Text of file, the first lines are used
+  */
+  FileType* chooseFileTypeOf(const UnicodeString* filePath, LineSource* lineSource);
+
   size_t getFileTypesCount();
 
   /** Total number of declared regions
@@ -68,6 +77,19 @@ class HrcLibrary
   */
   const Region* getRegion(const UnicodeString* name);
 
+  /** Returns pattern of the scheme nodes start regexp, or null, if the regexp is unknown.
+   */
+  const UnicodeString* getRegExpPattern(const CRegExp* re);
+
+  /** Loads all file types and forbids further changes of the library.
+      Frozen library is used for reading only, so several TextParser instances
+      can parse texts with it at the same time, one parser per thread.
+      After the freeze #loadSource() throws HrcLibraryException.
+      @note Parameters of the file types must not be changed during the parsing.
+  */
+  void freeze();
+  bool isFrozen() const;
+
   ~HrcLibrary() = default;
   HrcLibrary();
 
@@ -1,6 +1,7 @@
 #ifndef COLORER_PARSERFACTORY_H
 #define COLORER_PARSERFACTORY_H
 
+#include <functional>
 #include "colorer/Common.h"
 #include "colorer/Exception.h"
 #include "colorer/HrcLibrary.h"
@@ -57,6 +58,19 @@ class ParserFactory
    * Creates TextParser instance
    */
   std::unique_ptr<TextParser> createTextParser();
+
+  /**
+   * Parses the files in parallel, each thread uses its own TextParser instance.
+   * File type is chosen by the file name and the first lines of the text.
+   * HrcLibrary is frozen before the parse, see HrcLibrary#freeze().
+   * @param files Paths of the files.
+   * @param threads Number of the parsing threads, 0 - number of the hardware threads.
+   * @param createHandler Creates region handler for the file by its index in @c files.
+   *        Called in the parsing thread, handler is destroyed after the parse of the file.
+   * @return Number of the parsed files. Errors of the other files are logged.
+   */
+  size_t colorizeBatch(const std::vector<UnicodeString>& files, unsigned int threads,
+                       const std::function<std::unique_ptr<RegionHandler>(size_t)>& createHandler);
   /**
    * Creates RegionMapper instance and loads specified hrd files into it.
    * @param classID Class identifier of loaded hrd instance.
@@ -6,6 +6,8 @@
 #include "colorer/RegionHandler.h"
 #include "colorer/common/spimpl.h"
 
+struct RegExpProfile;
+
 /**
  * Basic lexical/syntax parser interface.
  * This class provides interface to lexical text parsing abilities of
@@ -78,6 +80,23 @@ class TextParser
    */
   int parse(int from, int num, TextParseMode mode);
 
+  /**
+   * Performs text parse without cache, as #parse() in TPM_CACHE_OFF mode,
+   * with several threads. Text is split into chunks, each chunk is parsed
+   * as if its first line starts in the base scheme. If the chunk really starts
+   * inside of a block, the text is parsed again from the previous line in the base scheme
+   * up to the line, which starts in the base scheme in both parses.
+   * Region handler gets the results in this thread in the order of lines,
+   * with the pointers to the copies of the lines.
+   * @note LineSource#getLine() is called from several threads at once, so it must be
+   *       thread-safe for this call, and the returned line must be valid until the next
+   *       call of the same thread.
+   * @param from  Line to start parsing
+   * @param num   Number of lines to parse
+   * @param threads Number of the parsing threads, 0 - number of the hardware threads.
+   */
+  int parseParallel(int from, int num, unsigned int threads);
+
   /**
    * Performs break of parsing process from external thread.
    * It is used to stop parse from external source. This is required
@@ -91,6 +110,15 @@ class TextParser
    */
   void clearCache();
   void setMaxBlockSize(int max_block_size);
+  /**
+   * Sets maximum number of matching steps of the single regexp match, 0 - no limit.
+   * The match, which reaches the limit, is abandoned and is treated as not matched.
+   */
+  void setRegExpStepLimit(int step_limit);
+  /**
+   * Starts collecting statistics of the regexp matches into @c profile, null stops it.
+   */
+  void setRegExpProfile(RegExpProfile* profile);
 
   ~TextParser() = default;
 
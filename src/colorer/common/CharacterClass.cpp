@@ -0,0 +1,38 @@
+#include "colorer/common/CharacterClass.h"
+#include <algorithm>
+
+CharacterClass::CharacterClass(const icu::UnicodeSet& set) : charset(set)
+{
+  freeze();
+}
+
+CharacterClass* CharacterClass::freeze()
+{
+  charset.freeze();
+
+  // bitmap of all BMP
+  std::vector<uint32_t> bits(0x10000 / 32, 0);
+  for (int32_t i = 0; i < charset.getRangeCount(); i++) {
+    UChar32 start = charset.getRangeStart(i);
+    if (start > 0xFFFF)
+      break;
+    UChar32 end = std::min(charset.getRangeEnd(i), static_cast<UChar32>(0xFFFF));
+    for (UChar32 c = start; c <= end; c++) bits[c >> 5] |= 1u << (c & 31);
+  }
+
+  blocks.clear();
+  for (int high = 0; high < 256; high++) {
+    auto block = bits.begin() + high * BLOCK_WORDS;
+    // same blocks are stored once
+    size_t count = blocks.size() / BLOCK_WORDS;
+    size_t found = count;
+    for (size_t i = 0; i < count && found == count; i++)
+      if (std::equal(block, block + BLOCK_WORDS, blocks.begin() + i * BLOCK_WORDS))
+        found = i;
+    if (found == count)
+      blocks.insert(blocks.end(), block, block + BLOCK_WORDS);
+    index[high] = static_cast<uint16_t>(found);
+  }
+  std::copy(bits.begin(), bits.begin() + 4, ascii);
+  return this;
+}
@@ -0,0 +1,61 @@
+#ifndef COLORER_COMMON_CHARACTERCLASS_H
+#define COLORER_COMMON_CHARACTERCLASS_H
+
+#include <unicode/uniset.h>
+#include <vector>
+#include "colorer/Common.h"
+
+/** Set of characters with fast membership test for BMP code units.
+    After #freeze the set keeps ASCII mask and two-level bitmap of BMP,
+    so #contains doesn't do binary search of UnicodeSet.
+*/
+class CharacterClass
+{
+ public:
+  CharacterClass() = default;
+  /** Creates frozen class with the characters of the set.
+  */
+  explicit CharacterClass(const icu::UnicodeSet& set);
+
+  void add(UChar32 c)
+  {
+    charset.add(c);
+  }
+
+  /** Builds the lookup tables, the class must not be changed after it.
+  */
+  CharacterClass* freeze();
+
+  inline bool contains(UChar c) const
+  {
+    if (blocks.empty())
+      return charset.contains(c);
+    if (c < 128)
+      return ascii[c >> 5] & (1u << (c & 31));
+    return blocks[index[c >> 8] * BLOCK_WORDS + ((c & 0xFF) >> 5)] & (1u << (c & 31));
+  }
+
+  /** Membership test for the code point out of BMP, the set is searched.
+  */
+  bool containsSupplementary(UChar32 c) const
+  {
+    return charset.contains(c);
+  }
+
+  const icu::UnicodeSet& getSet() const
+  {
+    return charset;
+  }
+
+ private:
+  // 256 code units in block
+  static constexpr int BLOCK_WORDS = 8;
+
+  icu::UnicodeSet charset;
+  uint32_t ascii[4] = {};
+  // block number for the high byte of code unit, same blocks are shared
+  uint16_t index[256] = {};
+  std::vector<uint32_t> blocks;
+};
+
+#endif  // COLORER_COMMON_CHARACTERCLASS_H
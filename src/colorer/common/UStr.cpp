@@ -1,4 +1,6 @@
 #include "colorer/common/UStr.h"
+#include <unicode/ustring.h>
+#include <algorithm>
 
 UnicodeString UStr::to_unistr(const int number)
 {
@@ -72,48 +74,48 @@ std::string UStr::to_stdstr(const XMLCh* str)
   return _string;
 }
 
-bool UStr::isLowerCase(UChar c)
+const uint8_t* UStr::createCharProperties()
 {
-  return u_islower(c);
-}
-
-bool UStr::isUpperCase(UChar c)
-{
-  return u_isupper(c);
-}
-
-bool UStr::isLetter(UChar c)
-{
-  return u_isalpha(c);
-}
-
-bool UStr::isLetterOrDigit(UChar c)
-{
-  return u_isdigit(c) || u_isalpha(c);
-}
-
-bool UStr::isDigit(UChar c)
-{
-  return u_isdigit(c);
-}
-
-bool UStr::isWhitespace(UChar c)
-{
-  return u_isspace(c);
-}
-
-UChar UStr::toLowerCase(UChar c)
-{
-  return (UChar) u_tolower(c);
+  static uint8_t table[0x10000];
+  for (UChar32 c = 0; c <= 0xFFFF; c++) {
+    uint8_t props = 0;
+    if (u_islower(c))
+      props |= CP_LOWER;
+    if (u_isupper(c))
+      props |= CP_UPPER;
+    if (u_isalpha(c))
+      props |= CP_LETTER;
+    if (u_isdigit(c))
+      props |= CP_DIGIT;
+    if (u_isspace(c))
+      props |= CP_SPACE;
+    if (u_isalpha(c) || u_isdigit(c) || c == '_')
+      props |= CP_WORD;
+    if (c == 0x0A || c == 0x0B || c == 0x0C || c == 0x0D || c == 0x85 || c == 0x2028 ||
+        c == 0x2029)
+      props |= CP_NEWLINE;
+    table[c] = props;
+  }
+  return table;
 }
 
-UChar UStr::toUpperCase(UChar c)
+const UStr::CaseTables& UStr::createCaseTables()
 {
-  return (UChar) u_toupper(c);
+  static CaseTables tables;
+  for (UChar32 c = 0; c <= 0xFFFF; c++) {
+    tables.lower[c] = (UChar) u_tolower(c);
+    tables.upper[c] = (UChar) u_toupper(c);
+    UChar src = (UChar) c;
+    UChar folded[4];
+    UErrorCode err = U_ZERO_ERROR;
+    int32_t len = u_strFoldCase(folded, 4, &src, 1, U_FOLD_CASE_DEFAULT, &err);
+    tables.fold[c] = (U_SUCCESS(err) && len == 1) ? folded[0] : BAD_WCHAR;
+  }
+  return tables;
 }
 
-std::unique_ptr<icu::UnicodeSet> UStr::createCharClass(const UnicodeString& ccs, int pos,
-                                                       int* retPos, bool ignore_case)
+std::unique_ptr<CharacterClass> UStr::createCharClass(const UnicodeString& ccs, int pos,
+                                                      int* retPos, bool ignore_case)
 {
   if (ccs[pos] != '[') {
     return nullptr;
@@ -139,7 +141,7 @@ std::unique_ptr<icu::UnicodeSet> UStr::createCharClass(const UnicodeString& ccs,
       if (inverse) {
         cc->complement();
       }
-      return cc;
+      return std::make_unique<CharacterClass>(*cc);
     }
     if (ccs[pos] == '{') {
       auto categ = getCurlyContent(ccs, pos);
@@ -225,7 +227,7 @@ std::unique_ptr<icu::UnicodeSet> UStr::createCharClass(const UnicodeString& ccs,
       if (retEnd == ccs.length() || scc == nullptr) {
         return nullptr;
       }
-      cc->removeAll(*scc);
+      cc->removeAll(scc->getSet());
       pos = retEnd;
       prev_char = BAD_WCHAR;
       continue;
@@ -237,7 +239,7 @@ std::unique_ptr<icu::UnicodeSet> UStr::createCharClass(const UnicodeString& ccs,
       if (retEnd == ccs.length() || scc == nullptr) {
         return nullptr;
       }
-      cc->retainAll(*scc);
+      cc->retainAll(scc->getSet());
       pos = retEnd;
       prev_char = BAD_WCHAR;
       continue;
@@ -249,7 +251,7 @@ std::unique_ptr<icu::UnicodeSet> UStr::createCharClass(const UnicodeString& ccs,
       if (scc == nullptr) {
         return nullptr;
       }
-      cc->addAll(*scc);
+      cc->addAll(scc->getSet());
       pos = retEnd;
       prev_char = BAD_WCHAR;
       continue;
@@ -265,6 +267,13 @@ std::unique_ptr<icu::UnicodeSet> UStr::createCharClass(const UnicodeString& ccs,
       pos = retEnd;
       continue;
     }
+    // surrogate pair is the one symbol out of BMP
+    if (U16_IS_LEAD(ccs[pos]) && pos + 1 < ccs.length() && U16_IS_TRAIL(ccs[pos + 1])) {
+      cc->add(U16_GET_SUPPLEMENTARY(ccs[pos], ccs[pos + 1]));
+      pos++;
+      prev_char = BAD_WCHAR;
+      continue;
+    }
     cc->add(ccs[pos]);
     if (ignore_case) {
       cc->add(u_tolower(prev_char));
@@ -377,6 +386,18 @@ int UStr::getNumber(const UnicodeString* pstr)
   return num;
 }
 
+bool UStr::hasSurrogates(const UnicodeString& str, int from, int to)
+{
+  const UChar* buf = str.getBuffer();
+  to = std::min(to, str.length());
+  for (int i = std::max(from, 0); i < to; i++) {
+    if (U16_IS_SURROGATE(buf[i])) {
+      return true;
+    }
+  }
+  return false;
+}
+
 bool UStr::HexToUInt(const UnicodeString& str_hex, unsigned int* result)
 {
   UnicodeString s;
@@ -1,10 +1,12 @@
 #ifndef COLORER_USTR_H
 #define COLORER_USTR_H
 
+#include <unicode/uchar.h>
 #include <unicode/uniset.h>
 #include <filesystem>
 #include <xercesc/util/XMLString.hpp>
 #include "colorer/Common.h"
+#include "colorer/common/CharacterClass.h"
 
 class UStr
 {
@@ -24,18 +26,100 @@ class UStr
   {
     return *string == '\0';
   }
-  static bool isLowerCase(UChar c);
-  static bool isUpperCase(UChar c);
-  static bool isLetter(UChar c);
-  static bool isLetterOrDigit(UChar c);
-  static bool isDigit(UChar c);
-  static bool isWhitespace(UChar c);
+  /** Properties of the code unit, bits of the table, returned by #getCharProperties.
+  */
+  enum CharProperty : uint8_t {
+    CP_LOWER = 1,    // u_islower
+    CP_UPPER = 2,    // u_isupper
+    CP_LETTER = 4,   // u_isalpha
+    CP_DIGIT = 8,    // u_isdigit
+    CP_SPACE = 16,   // u_isspace
+    CP_WORD = 32,    // letter, digit or '_'
+    CP_NEWLINE = 64  // \n \v \f \r \x85 \x{2028} \x{2029}
+  };
 
-  static UChar toLowerCase(UChar c);
-  static UChar toUpperCase(UChar c);
+  /** Table of CharProperty bits for each code unit of BMP.
+      Built on the first call from ICU properties.
+  */
+  static const uint8_t* getCharProperties()
+  {
+    static const uint8_t* const table = createCharProperties();
+    return table;
+  }
+
+  inline static bool isLowerCase(UChar c)
+  {
+    return getCharProperties()[c] & CP_LOWER;
+  }
+  inline static bool isUpperCase(UChar c)
+  {
+    return getCharProperties()[c] & CP_UPPER;
+  }
+  inline static bool isLetter(UChar c)
+  {
+    return getCharProperties()[c] & CP_LETTER;
+  }
+  inline static bool isLetterOrDigit(UChar c)
+  {
+    return getCharProperties()[c] & (CP_LETTER | CP_DIGIT);
+  }
+  inline static bool isDigit(UChar c)
+  {
+    return getCharProperties()[c] & CP_DIGIT;
+  }
+  inline static bool isWhitespace(UChar c)
+  {
+    return getCharProperties()[c] & CP_SPACE;
+  }
+  inline static bool isWordSymbol(UChar c)
+  {
+    return getCharProperties()[c] & CP_WORD;
+  }
+  inline static bool isLineBreak(UChar c)
+  {
+    return getCharProperties()[c] & CP_NEWLINE;
+  }
+  /** #isWordSymbol for the code point out of BMP.
+  */
+  inline static bool isWordCodePoint(UChar32 c)
+  {
+    return u_isalpha(c) || u_isdigit(c);
+  }
+  /** Checks, if the code units in [from, to) have surrogates.
+  */
+  static bool hasSurrogates(const UnicodeString& str, int from, int to);
+
+  /** Simple case mappings and full case folding of each code unit of BMP.
+      fold[c] is BAD_WCHAR, when the folding of c takes more than one code unit.
+  */
+  struct CaseTables
+  {
+    UChar lower[0x10000];
+    UChar upper[0x10000];
+    UChar fold[0x10000];
+  };
+
+  static const CaseTables& getCaseTables()
+  {
+    static const CaseTables& tables = createCaseTables();
+    return tables;
+  }
 
-  static std::unique_ptr<icu::UnicodeSet> createCharClass(const UnicodeString& ccs, int pos,
-                                                          int* retPos, bool ignore_case);
+  inline static UChar toLowerCase(UChar c)
+  {
+    return getCaseTables().lower[c];
+  }
+  inline static UChar toUpperCase(UChar c)
+  {
+    return getCaseTables().upper[c];
+  }
+  inline static UChar foldCase(UChar c)
+  {
+    return getCaseTables().fold[c];
+  }
+
+  static std::unique_ptr<CharacterClass> createCharClass(const UnicodeString& ccs, int pos,
+                                                         int* retPos, bool ignore_case);
   /** \\x{2028} \\x23 \\c  - into wchar
     @param str String to parse Escape sequence.
     @param pos Position, where sequence starts.
@@ -60,6 +144,10 @@ class UStr
   static uUnicodeString getCurlyContent(const UnicodeString& str, int pos);
 
   static bool HexToUInt(const UnicodeString& str_hex, unsigned int* result);
+
+ private:
+  static const uint8_t* createCharProperties();
+  static const CaseTables& createCaseTables();
 };
 
 #endif  // COLORER_USTR_H
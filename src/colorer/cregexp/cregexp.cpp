@@ -1,8 +1,84 @@
 #include "colorer/cregexp/cregexp.h"
+#include <algorithm>
+#include <chrono>
+#include <climits>
+#include <unicode/ustring.h>
 #include "colorer/common/UStr.h"
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define CREGEXP_SSE2
+#endif
+
+
+/////////////////////////////////////////////////////////////////////////////
+//
+RegExpContext::~RegExpContext()
+{
+  clear();
+}
+
+void RegExpContext::clear()
+{
+  delete[] stack;
+  stack = nullptr;
+  stack_size = 0;
+  delete[] frames;
+  frames = nullptr;
+  frames_size = 0;
+  count_elem = 0;
+  dfa.clear();
+  dfa_states = 0;
+  nfa_marks.clear();
+  nfa_mark = 0;
+  memo.clear();
+  memo_words.clear();
+}
+
+void RegExpContext::dfaFlush(unsigned int id)
+{
+  if (dfa_states >= DFA_MAX_TOTAL_STATES) {
+    dfa.clear();
+    dfa_states = 0;
+    return;
+  }
+  auto it = dfa.find(id);
+  if (it != dfa.end()) {
+    dfa_states -= static_cast<int>(it->second->states.size()) - 1;
+    dfa.erase(it);
+  }
+}
+
+RegExpContext* RegExpContext::getThreadContext()
+{
+  static thread_local RegExpContext thread_context;
+  return &thread_context;
+}
+
+void RegExpContext::setStepLimit(int limit)
+{
+  step_limit = limit;
+}
+
+int RegExpContext::getStepLimit() const
+{
+  return step_limit;
+}
+
+void RegExpContext::setSurrogateFree(const UnicodeString* str)
+{
+  surrogate_free = str;
+}
+
+void RegExpContext::setProfile(RegExpProfile* profile_)
+{
+  profile = profile_;
+}
+
+EMatchResult RegExpContext::getLastResult() const
+{
+  return last_result;
+}
 
-StackElem* CRegExp::RegExpStack {nullptr};
-int CRegExp::RegExpStack_Size {0};
 /////////////////////////////////////////////////////////////////////////////
 //
 SRegInfo::SRegInfo()
@@ -42,9 +118,8 @@ void CRegExp::init()
   tree_root = nullptr;
   positionMoves = false;
   error = EError::EERROR;
-  firstChar = 0;
   cMatch = 0;
-  global_pattern = nullptr;
+  nodeCount = 0;
 #ifdef COLORERMODE
   backRE = nullptr;
   backStr = nullptr;
@@ -55,7 +130,6 @@ void CRegExp::init()
 #else
   namedMatches = 0;
 #endif
-  count_elem = 0;
 }
 CRegExp::CRegExp()
 {
@@ -83,6 +157,8 @@ EError CRegExp::setRELow(const UnicodeString& expr)
 
   delete tree_root;
   tree_root = nullptr;
+  program.clear();
+  native = nullptr;
 #ifndef NAMED_MATCHES_IN_HASH
   for (int bp = 0; bp < cnMatch; bp++) delete brnames[bp];
 #endif
@@ -91,7 +167,7 @@ EError CRegExp::setRELow(const UnicodeString& expr)
 #ifndef NAMED_MATCHES_IN_HASH
   cnMatch = 0;
 #endif
-  endChange = startChange = false;
+  nodeCount = 0;
   int start = 0;
   while (UStr::isWhitespace(expr[start])) start++;
   if (expr[start] == '/')
@@ -133,25 +209,196 @@ EError CRegExp::setRELow(const UnicodeString& expr)
 
   if (err != EError::EOK)
     return err;
+  nodeCount = numberNodes(tree_root, 0);
+  memoCount = markMemoRanges(tree_root, !hasBackReferences(tree_root), 0, false);
+  codePoints = hasCodePointOps(tree_root);
+#ifdef COLORERMODE
+  backTraceBrackets = 0;
+  backTraceNamed = 0;
+  markBackTrace(tree_root);
+#endif
+#ifndef NAMED_MATCHES_IN_HASH
+  program.resize(nodeCount);
+  compileProgram(tree_root);
+  compileNfa();
+#endif
   optimize();
   return EError::EOK;
 }
 
+int CRegExp::numberNodes(SRegInfo* re, int id)
+{
+  for (; re; re = re->next) {
+    re->id = id++;
+    if (re->op > EOps::ReBlockOps &&
+        (re->op < EOps::ReSymbolOps || re->op == EOps::ReBrackets ||
+         re->op == EOps::ReNamedBrackets))
+      id = numberNodes(re->un.param, id);
+  }
+  return id;
+}
+
+/**
+  Checks, if the subtree has the operators, which match surrogate pair as one symbol.
+*/
+bool CRegExp::hasCodePointOps(const SRegInfo* re)
+{
+  for (; re; re = re->next) {
+    if (re->op == EOps::ReEnum || re->op == EOps::ReNEnum)
+      return true;
+    if (re->op == EOps::ReMetaSymb && (re->un.metaSymbol == EMetaSymbols::ReAnyChr ||
+                                       re->un.metaSymbol == EMetaSymbols::ReWordSymb ||
+                                       re->un.metaSymbol == EMetaSymbols::ReNWordSymb))
+      return true;
+    if (re->op > EOps::ReBlockOps &&
+        (re->op < EOps::ReSymbolOps || re->op == EOps::ReBrackets ||
+         re->op == EOps::ReNamedBrackets) &&
+        hasCodePointOps(re->un.param))
+      return true;
+  }
+  return false;
+}
+
+/**
+  Checks, if the subtree has the references to the brackets of this RE.
+*/
+bool CRegExp::hasBackReferences(const SRegInfo* re)
+{
+  for (; re; re = re->next) {
+    if (re->op == EOps::ReBkBrack || re->op == EOps::ReBkBrackName)
+      return true;
+    if (re->op > EOps::ReBlockOps &&
+        (re->op < EOps::ReSymbolOps || re->op == EOps::ReBrackets ||
+         re->op == EOps::ReNamedBrackets) &&
+        hasBackReferences(re->un.param))
+      return true;
+  }
+  return false;
+}
+
+#ifdef COLORERMODE
+/**
+  Marks the brackets of backRE, which are read by \y \Y operators of the subtree.
+*/
+void CRegExp::markBackTrace(const SRegInfo* re)
+{
+  for (; re; re = re->next) {
+    if ((re->op == EOps::ReBkTrace || re->op == EOps::ReBkTraceN) && re->param0 != -1)
+      backTraceBrackets |= 1u << re->param0;
+    if ((re->op == EOps::ReBkTraceName || re->op == EOps::ReBkTraceNName) && re->param0 != -1)
+      backTraceNamed |= 1u << re->param0;
+    if (re->op > EOps::ReBlockOps &&
+        (re->op < EOps::ReSymbolOps || re->op == EOps::ReBrackets ||
+         re->op == EOps::ReNamedBrackets))
+      markBackTrace(re->un.param);
+  }
+}
+#endif
+
+/**
+  Checks, if the subtree writes the brackets of the match, other than the whole match,
+  or moves its bounds by \m \M.
+*/
+bool CRegExp::hasCaptures(const SRegInfo* re)
+{
+  for (; re; re = re->next) {
+    if ((re->op == EOps::ReBrackets && re->param0 > 0) ||
+        (re->op == EOps::ReNamedBrackets && re->param0 != -1))
+      return true;
+#ifdef COLORERMODE
+    if (re->op == EOps::ReMetaSymb &&
+        (re->un.metaSymbol == EMetaSymbols::ReStart || re->un.metaSymbol == EMetaSymbols::ReEnd))
+      return true;
+#endif
+    if (re->op > EOps::ReBlockOps &&
+        (re->op < EOps::ReSymbolOps || re->op == EOps::ReBrackets ||
+         re->op == EOps::ReNamedBrackets) &&
+        hasCaptures(re->un.param))
+      return true;
+  }
+  return false;
+}
+
+/**
+  Gives memo slots to the unbounded ranges, which are not nested into other ranges
+  or lookarounds. Failure of such range decision at the position doesn't depend
+  on the way it was reached, unless RE has backreferences, so the decision
+  is tried only once in the parse call. Other ranges get -1.
+  Brackets are not restored on backtracking, and the failed branches leave their
+  values in the match, so the ranges, which are followed by the writes of the brackets
+  in the range or after it, get -1 too, not to change the brackets of the match.
+  @return Next free slot.
+*/
+int CRegExp::markMemoRanges(SRegInfo* re, bool allowed, int slot, bool capturesAfter)
+{
+  for (; re; re = re->next) {
+    bool range = re->op >= EOps::ReRangeN && re->op <= EOps::ReNGRangeNM;
+    bool after = capturesAfter || hasCaptures(re->next);
+    if (range) {
+      bool unbounded = re->op == EOps::ReRangeN || re->op == EOps::ReNGRangeN;
+      re->param0 = allowed && unbounded && !after && !hasCaptures(re->un.param) ? slot++ : -1;
+    }
+    bool lookaround = re->op >= EOps::ReBehind && re->op <= EOps::ReNAhead;
+    if (re->op > EOps::ReBlockOps &&
+        (re->op < EOps::ReSymbolOps || re->op == EOps::ReBrackets ||
+         re->op == EOps::ReNamedBrackets)) {
+      // the closing bracket is written after its content
+      bool closes = (re->op == EOps::ReBrackets && re->param0 > 0) ||
+                    (re->op == EOps::ReNamedBrackets && re->param0 != -1);
+      slot = markMemoRanges(re->un.param, allowed && !range && !lookaround, slot, after || closes);
+    }
+  }
+  return slot;
+}
+
+/**
+  Counts the failure of the range branch and starts the memo after MEMO_MIN_FAILS of them,
+  short matches don't pay for it.
+  The parser calls RE at each position of the line, so the memo of the context is not
+  allocated and cleared as a whole for each call: the words, written by the previous call,
+  are cleared, the buffer only grows.
+  @return true, if the memo is started.
+*/
+bool CRegExp::startMemo(MatchState& st) const
+{
+  if (++st.memoFails < MEMO_MIN_FAILS)
+    return false;
+  RegExpContext* ctx = st.context;
+  for (size_t word : ctx->memo_words)
+    ctx->memo[word] = 0;
+  ctx->memo_words.clear();
+  size_t size = (static_cast<size_t>(memoCount) * (st.end + 1) * 2 + 63) / 64;
+  if (ctx->memo.size() < size)
+    ctx->memo.resize(size);
+  st.memo = ctx->memo.data();
+  return true;
+}
+
+/**
+  Sets MEMO_* bits of the range decision at the position.
+*/
+void CRegExp::memoMark(MatchState& st, int slot, int toParse, int state) const
+{
+  if (!st.memo && (state != MEMO_FAILED || !startMemo(st)))
+    return;
+  if (toParse > st.end)
+    return;
+  size_t bit = (static_cast<size_t>(slot) * (st.end + 1) + toParse) * 2;
+  uint64_t& word = st.memo[bit >> 6];
+  if (!word)
+    st.context->memo_words.push_back(bit >> 6);
+  word |= static_cast<uint64_t>(state) << (bit & 63);
+}
+
 void CRegExp::optimize()
 {
   SRegInfo* next = tree_root;
-  firstChar = BAD_WCHAR;
   firstMetaChar = EMetaSymbols::ReBadMeta;
   while (next) {
     if (next->op == EOps::ReBrackets) {
       next = next->un.param;
       continue;
     }
-    /*    if (next->op == EOps::ReMetaSymb &&
-            next->un.metaSymbol >= ReWBound && next->un.metaSymbol < ReChrLast){
-          next = next->next;
-          continue;
-        };*/
     if (next->op == EOps::ReMetaSymb) {
       if (next->un.metaSymbol != EMetaSymbols::ReSoL &&
           next->un.metaSymbol != EMetaSymbols::ReWBound)
@@ -159,15 +406,424 @@ void CRegExp::optimize()
       firstMetaChar = next->un.metaSymbol;
       break;
     }
-    if (next->op == EOps::ReSymb) {
-      firstChar = next->un.symbol;
-      break;
+    break;
+  }
+
+  minLength = minLengthNode(tree_root);
+  requiredLiteral.remove();
+  literalOffset = -1;
+  if (!ignoreCase)
+    extractLiteral(tree_root->un.param, 0);
+  classify();
+  firstSet.reset();
+  icu::UnicodeSet set;
+  if (firstSetNode(tree_root, set))
+    return;
+  // symbol out of BMP starts with the lead surrogate
+  if (!set.containsNone(0x10000, 0x10FFFF))
+    set.add(0xD800, 0xDBFF);
+  if (set.contains(0, 0xFFFF))
+    return;
+  firstSet = std::make_unique<CharacterClass>(set);
+}
+
+/**
+  Detects the special kinds of RE, which are matched without the engine.
+  They are typical for the ends of the blocks: closing quotes, comments, line ends.
+*/
+void CRegExp::classify()
+{
+  kind = EReKind::General;
+  const SRegInfo* re = tree_root->un.param;
+#ifndef NAMED_MATCHES_IN_HASH
+  if (!re || cMatch != 1 || cnMatch)
+    return;
+#else
+  return;
+#endif
+  bool symbols = !ignoreCase;
+  for (const SRegInfo* next = re; next && symbols; next = next->next)
+    symbols = next->op == EOps::ReSymb || next->op == EOps::ReWord;
+  // the whole RE is taken as the required literal
+  if (symbols && literalOffset == 0) {
+    kind = EReKind::Literal;
+    return;
+  }
+  if (re->next)
+    return;
+  if (re->op == EOps::ReMetaSymb && re->un.metaSymbol == EMetaSymbols::ReEoL && !multiLine)
+    kind = EReKind::EndOfLine;
+#ifdef COLORERMODE
+  if (re->op == EOps::ReBkTrace)
+    kind = EReKind::BackTrace;
+#endif
+}
+
+/**
+  Checks, if metasymbol matches one symbol, not the position.
+*/
+static bool isSymbolMeta(EMetaSymbols meta)
+{
+  return meta == EMetaSymbols::ReAnyChr ||
+         (meta >= EMetaSymbols::ReDigit && meta <= EMetaSymbols::ReNUCase);
+}
+
+/**
+  Set of BMP symbols, matched by metasymbol.
+*/
+static const icu::UnicodeSet& metaSymbolSet(EMetaSymbols meta)
+{
+  static const auto sets = [] {
+    std::vector<icu::UnicodeSet> res(static_cast<int>(EMetaSymbols::ReChrLast));
+    for (UChar32 c = 0; c <= 0xFFFF; c++) {
+      auto ch = static_cast<UChar>(c);
+      if (UStr::isDigit(ch))
+        res[static_cast<int>(EMetaSymbols::ReDigit)].add(c);
+      else
+        res[static_cast<int>(EMetaSymbols::ReNDigit)].add(c);
+      if (UStr::isWordSymbol(ch))
+        res[static_cast<int>(EMetaSymbols::ReWordSymb)].add(c);
+      else
+        res[static_cast<int>(EMetaSymbols::ReNWordSymb)].add(c);
+      if (UStr::isWhitespace(ch))
+        res[static_cast<int>(EMetaSymbols::ReWSpace)].add(c);
+      else
+        res[static_cast<int>(EMetaSymbols::ReNWSpace)].add(c);
+      if (UStr::isUpperCase(ch))
+        res[static_cast<int>(EMetaSymbols::ReUCase)].add(c);
+      if (UStr::isLowerCase(ch))
+        res[static_cast<int>(EMetaSymbols::ReNUCase)].add(c);
     }
-    if (next->op == EOps::ReWord) {
-      firstChar = (*next->un.word)[0];
+    for (auto& set : res) set.freeze();
+    return res;
+  }();
+  return sets[static_cast<int>(meta)];
+}
+
+/**
+  Adds possible first symbols of the chain into the set.
+  Returns true, if the chain can match empty string.
+*/
+bool CRegExp::firstSetChain(const SRegInfo* re, icu::UnicodeSet& set) const
+{
+  for (; re; re = re->next) {
+    if (re->op == EOps::ReOr) {
+      bool left = firstSetChain(re->un.param, set);
+      bool right = firstSetChain(re->next, set);
+      return left || right;
     }
-    break;
+    if (!firstSetNode(re, set))
+      return false;
+  }
+  return true;
+}
+
+bool CRegExp::firstSetNode(const SRegInfo* re, icu::UnicodeSet& set) const
+{
+  switch (re->op) {
+    case EOps::ReEmpty:
+      return true;
+    case EOps::ReBrackets:
+    case EOps::ReNamedBrackets:
+      return firstSetChain(re->un.param, set);
+    case EOps::ReSymb:
+      set.add(re->un.symbol);
+      if (ignoreCase) {
+        set.add(UStr::toLowerCase(re->un.symbol));
+        set.add(UStr::toUpperCase(re->un.symbol));
+      }
+      return false;
+    case EOps::ReWord: {
+      UChar c = (*re->un.word)[0];
+      if (!ignoreCase) {
+        set.add(c);
+        return false;
+      }
+      // case insensitive word is compared with full case folding
+      if (U16_IS_SURROGATE(c) || UStr::foldCase(c) == BAD_WCHAR) {
+        set.add(0, 0xFFFF);
+        return false;
+      }
+      icu::UnicodeSet closure(c, c);
+      closure.closeOver(USET_CASE_INSENSITIVE);
+      set.addAll(closure);
+      set.add(UStr::toLowerCase(c));
+      set.add(UStr::toUpperCase(c));
+      return false;
+    }
+    case EOps::ReMetaSymb:
+      switch (re->un.metaSymbol) {
+        case EMetaSymbols::ReAnyChr:
+          set.add(0, 0xFFFF);
+          return false;
+        case EMetaSymbols::ReWordSymb:
+          // letters out of BMP
+          set.add(0xD800, 0xDBFF);
+          set.addAll(metaSymbolSet(re->un.metaSymbol));
+          return false;
+        case EMetaSymbols::ReDigit:
+        case EMetaSymbols::ReNDigit:
+        case EMetaSymbols::ReNWordSymb:
+        case EMetaSymbols::ReWSpace:
+        case EMetaSymbols::ReNWSpace:
+        case EMetaSymbols::ReUCase:
+        case EMetaSymbols::ReNUCase:
+          set.addAll(metaSymbolSet(re->un.metaSymbol));
+          return false;
+        default:
+          return true;
+      }
+    case EOps::ReEnum:
+      set.addAll(re->un.charclass->getSet());
+      return false;
+    case EOps::ReNEnum: {
+      icu::UnicodeSet inverse(re->un.charclass->getSet());
+      set.addAll(inverse.complement());
+      return false;
+    }
+    case EOps::ReOr:
+      firstSetChain(re->un.param, set);
+      return true;
+    case EOps::ReRangeN:
+    case EOps::ReRangeNM:
+    case EOps::ReNGRangeN:
+    case EOps::ReNGRangeNM:
+      return firstSetChain(re->un.param, set) || re->s == 0;
+    case EOps::ReAhead:
+    case EOps::ReNAhead:
+    case EOps::ReBehind:
+    case EOps::ReNBehind:
+      return true;
+    default:
+      // backreferences
+      set.add(0, 0xFFFF);
+      return true;
+  }
+}
+
+int CRegExp::minLengthChain(const SRegInfo* re) const
+{
+  int len = 0;
+  for (; re; re = re->next) {
+    if (re->op == EOps::ReOr)
+      return len + std::min(minLengthChain(re->un.param), minLengthChain(re->next));
+    len += minLengthNode(re);
+  }
+  return len;
+}
+
+int CRegExp::minLengthNode(const SRegInfo* re) const
+{
+  switch (re->op) {
+    case EOps::ReBrackets:
+    case EOps::ReNamedBrackets:
+      return minLengthChain(re->un.param);
+    case EOps::ReSymb:
+    case EOps::ReEnum:
+    case EOps::ReNEnum:
+      return 1;
+    case EOps::ReWord:
+      return re->un.word->length();
+    case EOps::ReMetaSymb:
+      return isSymbolMeta(re->un.metaSymbol) ? 1 : 0;
+    case EOps::ReRangeN:
+    case EOps::ReRangeNM:
+    case EOps::ReNGRangeN:
+    case EOps::ReNGRangeNM:
+      // backtracker doesn't restore the counter, when it returns into previous iteration
+      if (re->s == 0 || hasBranches(re->un.param))
+        return 0;
+      return static_cast<int>(std::min<long long>(
+          static_cast<long long>(re->s) * minLengthChain(re->un.param), INT_MAX / 2));
+    default:
+      return 0;
+  }
+}
+
+/**
+  Checks, if the subtree has the nodes, which make backtracking points.
+*/
+bool CRegExp::hasBranches(const SRegInfo* re)
+{
+  for (; re; re = re->next) {
+    if (re->op > EOps::ReBlockOps && re->op < EOps::ReSymbolOps)
+      return true;
+    if ((re->op == EOps::ReBrackets || re->op == EOps::ReNamedBrackets) &&
+        hasBranches(re->un.param))
+      return true;
+  }
+  return false;
+}
+
+/**
+  Length of the text, matched by the chain, or -1 if it is not fixed.
+*/
+int CRegExp::fixedLength(const SRegInfo* re)
+{
+  int len = 0;
+  for (; re; re = re->next) {
+    switch (re->op) {
+      case EOps::ReSymb:
+      case EOps::ReEnum:
+      case EOps::ReNEnum:
+        len++;
+        break;
+      case EOps::ReWord:
+        len += re->un.word->length();
+        break;
+      case EOps::ReMetaSymb:
+        if (isSymbolMeta(re->un.metaSymbol))
+          len++;
+        break;
+      case EOps::ReBrackets:
+      case EOps::ReNamedBrackets: {
+        int blen = fixedLength(re->un.param);
+        if (blen == -1)
+          return -1;
+        len += blen;
+        break;
+      }
+      case EOps::ReAhead:
+      case EOps::ReNAhead:
+      case EOps::ReBehind:
+      case EOps::ReNBehind:
+        break;
+      default:
+        return -1;
+    }
+  }
+  return len;
+}
+
+/**
+  Searches the longest literal, which must be in any match of the chain.
+  @param offset Offset of the chain from the match start, -1 if not fixed.
+*/
+void CRegExp::extractLiteral(const SRegInfo* re, int offset)
+{
+  for (const SRegInfo* next = re; next; next = next->next)
+    if (next->op == EOps::ReOr)
+      return;
+
+  UnicodeString run;
+  int run_offset = offset;
+  auto end_run = [&]() {
+    if (run.length() > requiredLiteral.length()) {
+      requiredLiteral = run;
+      literalOffset = run_offset;
+    }
+    run.remove();
+  };
+  auto advance = [&](int len) {
+    offset = (offset == -1 || len == -1) ? -1 : offset + len;
+  };
+
+  for (; re; re = re->next) {
+    switch (re->op) {
+      case EOps::ReSymb:
+        if (run.isEmpty())
+          run_offset = offset;
+        run.append(re->un.symbol);
+        advance(1);
+        break;
+      case EOps::ReWord:
+        if (run.isEmpty())
+          run_offset = offset;
+        run.append(*re->un.word);
+        advance(re->un.word->length());
+        break;
+      case EOps::ReMetaSymb:
+        if (isSymbolMeta(re->un.metaSymbol)) {
+          end_run();
+          advance(1);
+        }
+        break;
+      case EOps::ReAhead:
+      case EOps::ReNAhead:
+      case EOps::ReBehind:
+      case EOps::ReNBehind:
+        break;
+      case EOps::ReEnum:
+      case EOps::ReNEnum:
+        end_run();
+        advance(1);
+        break;
+      case EOps::ReBrackets:
+      case EOps::ReNamedBrackets:
+        end_run();
+        extractLiteral(re->un.param, offset);
+        advance(fixedLength(re->un.param));
+        break;
+      case EOps::ReRangeN:
+      case EOps::ReRangeNM:
+      case EOps::ReNGRangeN:
+      case EOps::ReNGRangeNM:
+        end_run();
+        // first iteration is required, if the counter can't be broken by backtracking
+        if (re->s > 0 && !hasBranches(re->un.param))
+          extractLiteral(re->un.param, offset);
+        if ((re->op == EOps::ReRangeNM || re->op == EOps::ReNGRangeNM) && re->s == re->e) {
+          int blen = fixedLength(re->un.param);
+          advance(blen == -1 ? -1 : blen * re->s);
+        }
+        else
+          advance(-1);
+        break;
+      default:
+        end_run();
+        advance(-1);
+        break;
+    }
+  }
+  end_run();
+}
+
+/**
+  Searches the first occurrence of the string in the text before end.
+  @return Position of the occurrence or -1.
+*/
+static int findString(const UChar* text, int end, const UChar* lit, int len, int from)
+{
+  int last = end - len;
+  UChar first = lit[0];
+  int i = from < 0 ? 0 : from;
+#ifdef CREGEXP_SSE2
+  const __m128i needle = _mm_set1_epi16(static_cast<short>(first));
+  for (; i + 8 <= last + 1; i += 8) {
+    __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(text + i));
+    int mask = _mm_movemask_epi8(_mm_cmpeq_epi16(chunk, needle));
+    // two mask bits for each code unit
+    for (int j = i; mask; j++, mask >>= 2)
+      if ((mask & 1) && u_memcmp(text + j + 1, lit + 1, len - 1) == 0)
+        return j;
   }
+#endif
+  for (; i <= last; i++)
+    if (text[i] == first && u_memcmp(text + i + 1, lit + 1, len - 1) == 0)
+      return i;
+  return -1;
+}
+
+/**
+  Returns the position of the required literal in [from, end), or -1.
+*/
+int CRegExp::findLiteral(const MatchState& st, int from) const
+{
+  return findString(st.global_pattern->getBuffer(), st.end, requiredLiteral.getBuffer(),
+                    requiredLiteral.length(), from);
+}
+
+/**
+  Checks, if the full case folding of each word symbol is a single symbol,
+  so the folded word can be compared with the text symbol by symbol.
+*/
+static bool isFoldSingle(const UnicodeString& word)
+{
+  for (int i = 0; i < word.length(); i++) {
+    if (U16_IS_SURROGATE(word[i]) || UStr::foldCase(word[i]) == BAD_WCHAR)
+      return false;
+  }
+  return true;
 }
 
 EError CRegExp::setStructs(SRegInfo*& re, const UnicodeString& expr, int& retPos)
@@ -586,6 +1242,12 @@ EError CRegExp::setStructs(SRegInfo*& re, const UnicodeString& expr, int& retPos
       reword->op = EOps::ReWord;
       reword->un.word = new UnicodeString(wcword, wsize);
       delete[] wcword;
+      reword->param0 = 0;
+      if (ignoreCase && isFoldSingle(*reword->un.word)) {
+        // case insensitive word is folded once, matching folds only the text symbols
+        reword->un.word->foldCase();
+        reword->param0 = 1;
+      }
       reword->next = reafterword;
       if (reafterword)
         reafterword->prev = reword;
@@ -669,61 +1331,48 @@ EError CRegExp::setStructs(SRegInfo*& re, const UnicodeString& expr, int& retPos
 // parsing
 ////////////////////////////////////////////////////////////////////////////
 
-bool CRegExp::isWordBoundary(int toParse)
+bool CRegExp::isWordBoundary(const MatchState& st, int toParse) const
 {
+  const UnicodeString* global_pattern = st.global_pattern;
+  int end = st.end;
   int before = 0;
   int after = 0;
-  if (toParse < end &&
-      (UStr::isLetterOrDigit((*global_pattern)[toParse]) || (*global_pattern)[toParse] == '_'))
+  if (toParse < end && UStr::isWordSymbol((*global_pattern)[toParse]))
     after = 1;
-  if (toParse > 0 &&
-      (UStr::isLetterOrDigit((*global_pattern)[toParse - 1]) ||
-       (*global_pattern)[toParse - 1] == '_'))
+  if (toParse > 0 && UStr::isWordSymbol((*global_pattern)[toParse - 1]))
     before = 1;
   return before + after == 1;
 }
-bool CRegExp::isNWordBoundary(int toParse)
+bool CRegExp::isNWordBoundary(const MatchState& st, int toParse) const
 {
-  return !isWordBoundary(toParse);
+  return !isWordBoundary(st, toParse);
 }
 
-bool CRegExp::checkMetaSymbol(EMetaSymbols symb, int& toParse)
+bool CRegExp::checkMetaSymbol(MatchState& st, EMetaSymbols symb, int& toParse) const
 {
-  const UnicodeString& pattern = *global_pattern;
+  const UnicodeString& pattern = *st.global_pattern;
+  int end = st.end;
 
   switch (symb) {
     case EMetaSymbols::ReAnyChr:
       if (toParse >= end)
         return false;
-      if (!singleLine &&
-          (pattern[toParse] == 0x0A || pattern[toParse] == 0x0B || pattern[toParse] == 0x0C ||
-           pattern[toParse] == 0x0D || pattern[toParse] == 0x85 || pattern[toParse] == 0x2028 ||
-           pattern[toParse] == 0x2029))
+      if (!singleLine && UStr::isLineBreak(pattern[toParse]))
         return false;
+      if (U16_IS_LEAD(pattern[toParse]) && supplementaryAt(st, toParse))
+        toParse++;
       toParse++;
       return true;
     case EMetaSymbols::ReSoL:
       if (multiLine) {
-        bool ok = false;
-        if (toParse &&
-            (pattern[toParse - 1] == 0x0A || pattern[toParse - 1] == 0x0B ||
-             pattern[toParse - 1] == 0x0C || pattern[toParse - 1] == 0x0D ||
-             pattern[toParse - 1] == 0x85 || pattern[toParse - 1] == 0x2028 ||
-             pattern[toParse - 1] == 0x2029))
-          ok = true;
-        return (toParse == 0 || ok);
+        return (toParse == 0 || UStr::isLineBreak(pattern[toParse - 1]));
       }
       return (toParse == 0);
     case EMetaSymbols::ReEoL:
       if (multiLine) {
-        bool ok = false;  // ???check
-        if (toParse && toParse < end &&
-            (pattern[toParse - 1] == 0x0A || pattern[toParse - 1] == 0x0B ||
-             pattern[toParse - 1] == 0x0C || pattern[toParse - 1] == 0x0D ||
-             pattern[toParse - 1] == 0x85 || pattern[toParse - 1] == 0x2028 ||
-             pattern[toParse - 1] == 0x2029))
-          ok = true;
-        return (toParse == end || ok);
+        // ???check
+        return (toParse == end ||
+                (toParse && toParse < end && UStr::isLineBreak(pattern[toParse - 1])));
       }
       return (end == toParse);
     case EMetaSymbols::ReDigit:
@@ -737,12 +1386,32 @@ bool CRegExp::checkMetaSymbol(EMetaSymbols symb, int& toParse)
       toParse++;
       return true;
     case EMetaSymbols::ReWordSymb:
-      if (toParse >= end || !(UStr::isLetterOrDigit(pattern[toParse]) || pattern[toParse] == '_'))
+      if (toParse >= end)
+        return false;
+      if (U16_IS_LEAD(pattern[toParse])) {
+        if (UChar32 sc = supplementaryAt(st, toParse)) {
+          if (!UStr::isWordCodePoint(sc))
+            return false;
+          toParse += 2;
+          return true;
+        }
+      }
+      if (!UStr::isWordSymbol(pattern[toParse]))
         return false;
       toParse++;
       return true;
     case EMetaSymbols::ReNWordSymb:
-      if (toParse >= end || UStr::isLetterOrDigit(pattern[toParse]) || pattern[toParse] == '_')
+      if (toParse >= end)
+        return false;
+      if (U16_IS_LEAD(pattern[toParse])) {
+        if (UChar32 sc = supplementaryAt(st, toParse)) {
+          if (UStr::isWordCodePoint(sc))
+            return false;
+          toParse += 2;
+          return true;
+        }
+      }
+      if (UStr::isWordSymbol(pattern[toParse]))
         return false;
       toParse++;
       return true;
@@ -767,23 +1436,23 @@ bool CRegExp::checkMetaSymbol(EMetaSymbols symb, int& toParse)
       toParse++;
       return true;
     case EMetaSymbols::ReWBound:
-      return isWordBoundary(toParse);
+      return isWordBoundary(st, toParse);
     case EMetaSymbols::ReNWBound:
-      return isNWordBoundary(toParse);
+      return isNWordBoundary(st, toParse);
     case EMetaSymbols::RePreNW:
       if (toParse >= end)
         return true;
       return toParse == 0 || !UStr::isLetter(pattern[toParse - 1]);
 #ifdef COLORERMODE
     case EMetaSymbols::ReSoScheme:
-      return (schemeStart == toParse);
+      return (st.schemeStart == toParse);
     case EMetaSymbols::ReStart:
-      matches->s[0] = toParse;
-      startChange = true;
+      st.matches->s[0] = toParse;
+      st.startChange = true;
       return true;
     case EMetaSymbols::ReEnd:
-      matches->e[0] = toParse;
-      endChange = true;
+      st.matches->e[0] = toParse;
+      st.endChange = true;
       return true;
 #endif
     default:
@@ -791,15 +1460,15 @@ bool CRegExp::checkMetaSymbol(EMetaSymbols symb, int& toParse)
   }
 }
 
-void CRegExp::check_stack(bool res, SRegInfo** re, SRegInfo** prev, int* toParse, bool* leftenter,
-                          int* action)
+void CRegExp::check_stack(RegExpContext* context, bool res, SRegInfo** re, SRegInfo** prev,
+                          int* toParse, bool* leftenter, int* action)
 {
-  if (count_elem == 0) {
+  if (context->count_elem == 0) {
     *action = res;
     return;
   }
 
-  StackElem& ne = CRegExp::RegExpStack[--count_elem];
+  StackElem& ne = context->stack[--context->count_elem];
   if (res) {
     *action = ne.ifTrueReturn;
   }
@@ -812,22 +1481,24 @@ void CRegExp::check_stack(bool res, SRegInfo** re, SRegInfo** prev, int* toParse
   *leftenter = ne.leftenter;
 }
 
-void CRegExp::insert_stack(SRegInfo** re, SRegInfo** prev, int* toParse, bool* leftenter,
-                           int ifTrueReturn, int ifFalseReturn, SRegInfo** re2, SRegInfo** prev2,
-                           int toParse2)
+void CRegExp::insert_stack(RegExpContext* context, SRegInfo** re, SRegInfo** prev, int* toParse,
+                           bool* leftenter, int ifTrueReturn, int ifFalseReturn, SRegInfo** re2,
+                           SRegInfo** prev2, int toParse2)
 {
-  if (RegExpStack_Size == 0) {
-    CRegExp::RegExpStack = new StackElem[INIT_MEM_SIZE];
-    RegExpStack_Size = INIT_MEM_SIZE;
+  if (context->stack_size == 0) {
+    context->stack = new StackElem[INIT_MEM_SIZE];
+    context->stack_size = INIT_MEM_SIZE;
   }
-  if (RegExpStack_Size == count_elem) {
-    RegExpStack_Size += MEM_INC;
-    StackElem* s = new StackElem[RegExpStack_Size];
-    memcpy(s, CRegExp::RegExpStack, count_elem * sizeof(StackElem));
-    delete[] CRegExp::RegExpStack;
-    CRegExp::RegExpStack = s;
+  if (context->stack_size == context->count_elem) {
+    context->stack_size += MEM_INC;
+    StackElem* s = new StackElem[context->stack_size];
+    memcpy(s, context->stack, context->count_elem * sizeof(StackElem));
+    delete[] context->stack;
+    context->stack = s;
   }
-  StackElem& ne = CRegExp::RegExpStack[count_elem++];
+  StackElem& ne = context->stack[context->count_elem++];
+  if (context->count_elem > context->peak_elem)
+    context->peak_elem = context->count_elem;
   ne.re = *re;
   ne.prev = *prev;
   ne.toParse = *toParse;
@@ -849,12 +1520,23 @@ void CRegExp::insert_stack(SRegInfo** re, SRegInfo** prev, int* toParse, bool* l
   }
 }
 
-bool CRegExp::lowParse(SRegInfo* re, SRegInfo* prev, int toParse)
+bool CRegExp::lowParse(MatchState& st, SRegInfo* re, SRegInfo* prev, int toParse) const
 {
   int i, sv, wlen;
   bool leftenter = true;
   bool br = false;
-  const UnicodeString& pattern = *global_pattern;
+  const UnicodeString& pattern = *st.global_pattern;
+  const int end = st.end;
+  SMatches* matches = st.matches;
+#ifdef NAMED_MATCHES_IN_HASH
+  SMatchHash* namedMatches = st.namedMatches;
+#endif
+#ifdef COLORERMODE
+  const UnicodeString* backStr = st.backStr;
+  const SMatches* backTrace = st.backTrace;
+#endif
+  RegExpContext* context = st.context;
+  SRegState* nodes = st.nodes;
   int action = -1;
 
   if (!re) {
@@ -863,6 +1545,10 @@ bool CRegExp::lowParse(SRegInfo* re, SRegInfo* prev, int toParse)
   }
   while (true) {
     while (re || action != -1) {
+      if (st.stepLimit && ++st.steps > st.stepLimit) {
+        st.stepLimitHit = true;
+        return false;
+      }
       if (re && action == -1)
         switch (re->op) {
           case EOps::ReEmpty:
@@ -870,66 +1556,77 @@ bool CRegExp::lowParse(SRegInfo* re, SRegInfo* prev, int toParse)
           case EOps::ReBrackets:
           case EOps::ReNamedBrackets:
             if (leftenter) {
-              re->s = toParse;
+              nodes[re->id].s = toParse;
               re = re->un.param;
               continue;
             }
             if (re->param0 == -1)
               break;
             if (re->op == EOps::ReBrackets) {
-              if (re->param0 || !startChange)
-                matches->s[re->param0] = re->s;
-              if (re->param0 || !endChange)
+              if (re->param0 || !st.startChange)
+                matches->s[re->param0] = nodes[re->id].s;
+              if (re->param0 || !st.endChange)
                 matches->e[re->param0] = toParse;
               if (matches->e[re->param0] < matches->s[re->param0])
                 matches->s[re->param0] = matches->e[re->param0];
             }
             else {
 #ifndef NAMED_MATCHES_IN_HASH
-              matches->ns[re->param0] = re->s;
+              matches->ns[re->param0] = nodes[re->id].s;
               matches->ne[re->param0] = toParse;
               if (matches->ne[re->param0] < matches->ns[re->param0])
                 matches->ns[re->param0] = matches->ne[re->param0];
 #else
-              SMatch mt = {re->s, toParse};
+              SMatch mt = {nodes[re->id].s, toParse};
               namedMatches->setItem(re->namedata, mt);
 #endif
             }
             break;
           case EOps::ReSymb:
             if (toParse >= end) {
-              check_stack(false, &re, &prev, &toParse, &leftenter, &action);
+              check_stack(context, false, &re, &prev, &toParse, &leftenter, &action);
               continue;
             }
             if (ignoreCase) {
               if (UStr::toLowerCase(pattern[toParse]) != UStr::toLowerCase(re->un.symbol) &&
                   UStr::toUpperCase(pattern[toParse]) != UStr::toUpperCase(re->un.symbol))
               {
-                check_stack(false, &re, &prev, &toParse, &leftenter, &action);
+                check_stack(context, false, &re, &prev, &toParse, &leftenter, &action);
                 continue;
               }
             }
             else if (pattern[toParse] != re->un.symbol) {
-              check_stack(false, &re, &prev, &toParse, &leftenter, &action);
+              check_stack(context, false, &re, &prev, &toParse, &leftenter, &action);
               continue;
             }
             toParse++;
             break;
           case EOps::ReMetaSymb:
-            if (!checkMetaSymbol(re->un.metaSymbol, toParse)) {
-              check_stack(false, &re, &prev, &toParse, &leftenter, &action);
+            if (!checkMetaSymbol(st, re->un.metaSymbol, toParse)) {
+              check_stack(context, false, &re, &prev, &toParse, &leftenter, &action);
               continue;
             }
             break;
           case EOps::ReWord:
             wlen = re->un.word->length();
             if (toParse + wlen > end) {
-              check_stack(false, &re, &prev, &toParse, &leftenter, &action);
+              check_stack(context, false, &re, &prev, &toParse, &leftenter, &action);
               continue;
             }
-            if (ignoreCase) {
+            if (ignoreCase && re->param0) {
+              for (i = 0; i < wlen; i++) {
+                if (UStr::foldCase(pattern[toParse + i]) != (*re->un.word)[i])
+                  break;
+              }
+              if (i < wlen) {
+                check_stack(context, false, &re, &prev, &toParse, &leftenter, &action);
+                continue;
+              }
+              toParse += wlen;
+            }
+            else if (ignoreCase) {
               if (!UnicodeString(pattern, toParse, wlen).caseCompare(*re->un.word, 0) == 0) {
-                check_stack(false, &re, &prev, &toParse, &leftenter, &action);
+                check_stack(context, false, &re, &prev, &toParse, &leftenter, &action);
                 continue;
               }
               toParse += wlen;
@@ -938,7 +1635,7 @@ bool CRegExp::lowParse(SRegInfo* re, SRegInfo* prev, int toParse)
               br = false;
               for (i = 0; i < wlen; i++) {
                 if (pattern[toParse + i] != (*re->un.word)[i]) {
-                  check_stack(false, &re, &prev, &toParse, &leftenter, &action);
+                  check_stack(context, false, &re, &prev, &toParse, &leftenter, &action);
                   br = true;
                   break;
                 }
@@ -949,38 +1646,23 @@ bool CRegExp::lowParse(SRegInfo* re, SRegInfo* prev, int toParse)
             }
             break;
           case EOps::ReEnum:
-            if (toParse >= end) {
-              check_stack(false, &re, &prev, &toParse, &leftenter, &action);
-              continue;
-            }
-            if (!re->un.charclass->contains(pattern[toParse])) {
-              check_stack(false, &re, &prev, &toParse, &leftenter, &action);
-              continue;
-            }
-            toParse++;
-            break;
           case EOps::ReNEnum:
-            if (toParse >= end) {
-              check_stack(false, &re, &prev, &toParse, &leftenter, &action);
+            if (!checkClass(st, re->un.charclass, re->op == EOps::ReNEnum, toParse)) {
+              check_stack(context, false, &re, &prev, &toParse, &leftenter, &action);
               continue;
             }
-            if (re->un.charclass->contains(pattern[toParse])) {
-              check_stack(false, &re, &prev, &toParse, &leftenter, &action);
-              continue;
-            }
-            toParse++;
             break;
 #ifdef COLORERMODE
           case EOps::ReBkTrace:
             sv = re->param0;
             if (!backStr || !backTrace || sv == -1) {
-              check_stack(false, &re, &prev, &toParse, &leftenter, &action);
+              check_stack(context, false, &re, &prev, &toParse, &leftenter, &action);
               continue;
             }
             br = false;
             for (i = backTrace->s[sv]; i < backTrace->e[sv]; i++) {
               if (toParse >= end || pattern[toParse] != (*backStr)[i]) {
-                check_stack(false, &re, &prev, &toParse, &leftenter, &action);
+                check_stack(context, false, &re, &prev, &toParse, &leftenter, &action);
                 br = true;
                 break;
               }
@@ -992,14 +1674,14 @@ bool CRegExp::lowParse(SRegInfo* re, SRegInfo* prev, int toParse)
           case EOps::ReBkTraceN:
             sv = re->param0;
             if (!backStr || !backTrace || sv == -1) {
-              check_stack(false, &re, &prev, &toParse, &leftenter, &action);
+              check_stack(context, false, &re, &prev, &toParse, &leftenter, &action);
               continue;
             }
             br = false;
             for (i = backTrace->s[sv]; i < backTrace->e[sv]; i++) {
               if (toParse >= end ||
                   UStr::toLowerCase(pattern[toParse]) != UStr::toLowerCase((*backStr)[i])) {
-                check_stack(false, &re, &prev, &toParse, &leftenter, &action);
+                check_stack(context, false, &re, &prev, &toParse, &leftenter, &action);
                 br = true;
                 break;
               }
@@ -1012,13 +1694,13 @@ bool CRegExp::lowParse(SRegInfo* re, SRegInfo* prev, int toParse)
 #ifndef NAMED_MATCHES_IN_HASH
             sv = re->param0;
             if (!backStr || !backTrace || sv == -1) {
-              check_stack(false, &re, &prev, &toParse, &leftenter, &action);
+              check_stack(context, false, &re, &prev, &toParse, &leftenter, &action);
               continue;
             }
             br = false;
             for (i = backTrace->ns[sv]; i < backTrace->ne[sv]; i++) {
               if (toParse >= end || pattern[toParse] != (*backStr)[i]) {
-                check_stack(false, &re, &prev, &toParse, &leftenter, &action);
+                check_stack(context, false, &re, &prev, &toParse, &leftenter, &action);
                 br = true;
                 break;
               }
@@ -1030,7 +1712,7 @@ bool CRegExp::lowParse(SRegInfo* re, SRegInfo* prev, int toParse)
 #else
             // !!!;
             {
-              check_stack(false, &re, &prev, &toParse, &leftenter, &action);
+              check_stack(context, false, &re, &prev, &toParse, &leftenter, &action);
               continue;
             }
 #endif  // NAMED_MATCHES_IN_HASH
@@ -1038,14 +1720,14 @@ bool CRegExp::lowParse(SRegInfo* re, SRegInfo* prev, int toParse)
 #ifndef NAMED_MATCHES_IN_HASH
             sv = re->param0;
             if (!backStr || !backTrace || sv == -1) {
-              check_stack(false, &re, &prev, &toParse, &leftenter, &action);
+              check_stack(context, false, &re, &prev, &toParse, &leftenter, &action);
               continue;
             }
             br = false;
-            for (i = backTrace->s[sv]; i < backTrace->e[sv]; i++) {
+            for (i = backTrace->ns[sv]; i < backTrace->ne[sv]; i++) {
               if (toParse >= end ||
                   UStr::toLowerCase(pattern[toParse]) != UStr::toLowerCase((*backStr)[i])) {
-                check_stack(false, &re, &prev, &toParse, &leftenter, &action);
+                check_stack(context, false, &re, &prev, &toParse, &leftenter, &action);
                 br = true;
                 break;
               }
@@ -1057,7 +1739,7 @@ bool CRegExp::lowParse(SRegInfo* re, SRegInfo* prev, int toParse)
 #else
             // !!;
             {
-              check_stack(false, &re, &prev, &toParse, &leftenter, &action);
+              check_stack(context, false, &re, &prev, &toParse, &leftenter, &action);
               continue;
             }
 #endif  // NAMED_MATCHES_IN_HASH
@@ -1067,17 +1749,17 @@ bool CRegExp::lowParse(SRegInfo* re, SRegInfo* prev, int toParse)
 #ifndef NAMED_MATCHES_IN_HASH
             sv = re->param0;
             if (sv == -1 || cnMatch <= sv) {
-              check_stack(false, &re, &prev, &toParse, &leftenter, &action);
+              check_stack(context, false, &re, &prev, &toParse, &leftenter, &action);
               continue;
             }
             if (matches->ns[sv] == -1 || matches->ne[sv] == -1) {
-              check_stack(false, &re, &prev, &toParse, &leftenter, &action);
+              check_stack(context, false, &re, &prev, &toParse, &leftenter, &action);
               continue;
             }
             br = false;
             for (i = matches->ns[sv]; i < matches->ne[sv]; i++) {
               if (toParse >= end || pattern[toParse] != pattern[i]) {
-                check_stack(false, &re, &prev, &toParse, &leftenter, &action);
+                check_stack(context, false, &re, &prev, &toParse, &leftenter, &action);
                 br = true;
                 break;
               }
@@ -1090,17 +1772,17 @@ bool CRegExp::lowParse(SRegInfo* re, SRegInfo* prev, int toParse)
           {
             SMatch* mt = namedMatches->getItem(re->namedata);
             if (!mt) {
-              check_stack(false, &re, &prev, &toParse, &leftenter, &action);
+              check_stack(context, false, &re, &prev, &toParse, &leftenter, &action);
               continue;
             }
             if (mt->s == -1 || mt->e == -1) {
-              check_stack(false, &re, &prev, &toParse, &leftenter, &action);
+              check_stack(context, false, &re, &prev, &toParse, &leftenter, &action);
               continue;
             }
             br = false;
             for (i = mt->s; i < mt->e; i++) {
               if (toParse >= end || pattern[toParse] != pattern[i]) {
-                check_stack(false, &re, &prev, &toParse, &leftenter, &action);
+                check_stack(context, false, &re, &prev, &toParse, &leftenter, &action);
                 br = true;
                 break;
               }
@@ -1114,17 +1796,17 @@ bool CRegExp::lowParse(SRegInfo* re, SRegInfo* prev, int toParse)
           case EOps::ReBkBrack:
             sv = re->param0;
             if (sv == -1 || cMatch <= sv) {
-              check_stack(false, &re, &prev, &toParse, &leftenter, &action);
+              check_stack(context, false, &re, &prev, &toParse, &leftenter, &action);
               continue;
             }
             if (matches->s[sv] == -1 || matches->e[sv] == -1) {
-              check_stack(false, &re, &prev, &toParse, &leftenter, &action);
+              check_stack(context, false, &re, &prev, &toParse, &leftenter, &action);
               continue;
             }
             br = false;
             for (i = matches->s[sv]; i < matches->e[sv]; i++) {
               if (toParse >= end || pattern[toParse] != pattern[i]) {
-                check_stack(false, &re, &prev, &toParse, &leftenter, &action);
+                check_stack(context, false, &re, &prev, &toParse, &leftenter, &action);
                 br = true;
                 break;
               }
@@ -1135,48 +1817,48 @@ bool CRegExp::lowParse(SRegInfo* re, SRegInfo* prev, int toParse)
             break;
           case EOps::ReAhead:
             if (!leftenter) {
-              check_stack(true, &re, &prev, &toParse, &leftenter, &action);
+              check_stack(context, true, &re, &prev, &toParse, &leftenter, &action);
               continue;
             }
             {
-              insert_stack(&re, &prev, &toParse, &leftenter, rea_Break, rea_False, &re->un.param,
+              insert_stack(context, &re, &prev, &toParse, &leftenter, rea_Break, rea_False, &re->un.param,
                            nullptr, toParse);
               continue;
             }
             break;
           case EOps::ReNAhead:
             if (!leftenter) {
-              check_stack(true, &re, &prev, &toParse, &leftenter, &action);
+              check_stack(context, true, &re, &prev, &toParse, &leftenter, &action);
               continue;
             }
             {
-              insert_stack(&re, &prev, &toParse, &leftenter, rea_False, rea_Break, &re->un.param,
+              insert_stack(context, &re, &prev, &toParse, &leftenter, rea_False, rea_Break, &re->un.param,
                            nullptr, toParse);
               continue;
             }
             break;
           case EOps::ReBehind:
             if (!leftenter) {
-              check_stack(true, &re, &prev, &toParse, &leftenter, &action);
+              check_stack(context, true, &re, &prev, &toParse, &leftenter, &action);
               continue;
             }
             if (toParse - re->param0 < 0) {
-              check_stack(false, &re, &prev, &toParse, &leftenter, &action);
+              check_stack(context, false, &re, &prev, &toParse, &leftenter, &action);
               continue;
             }
             else {
-              insert_stack(&re, &prev, &toParse, &leftenter, rea_Break, rea_False, &re->un.param,
+              insert_stack(context, &re, &prev, &toParse, &leftenter, rea_Break, rea_False, &re->un.param,
                            nullptr, toParse - re->param0);
               continue;
             }
             break;
           case EOps::ReNBehind:
             if (!leftenter) {
-              check_stack(true, &re, &prev, &toParse, &leftenter, &action);
+              check_stack(context, true, &re, &prev, &toParse, &leftenter, &action);
               continue;
             }
             if (toParse - re->param0 >= 0) {
-              insert_stack(&re, &prev, &toParse, &leftenter, rea_False, rea_Break, &re->un.param,
+              insert_stack(context, &re, &prev, &toParse, &leftenter, rea_False, rea_Break, &re->un.param,
                            nullptr, toParse - re->param0);
               continue;
             }
@@ -1188,7 +1870,7 @@ bool CRegExp::lowParse(SRegInfo* re, SRegInfo* prev, int toParse)
               break;
             }
             {
-              insert_stack(&re, &prev, &toParse, &leftenter, rea_True, rea_Break, &re->un.param,
+              insert_stack(context, &re, &prev, &toParse, &leftenter, rea_True, rea_Break, &re->un.param,
                            nullptr, toParse);
               continue;
             }
@@ -1196,90 +1878,112 @@ bool CRegExp::lowParse(SRegInfo* re, SRegInfo* prev, int toParse)
           case EOps::ReRangeN:
             // first enter into op
             if (leftenter) {
-              re->param0 = re->s;
-              re->oldParse = -1;
+              nodes[re->id].param0 = re->s;
+              nodes[re->id].oldParse = -1;
             }
-            if (!re->param0 && re->oldParse == toParse)
+            if (!nodes[re->id].param0 && nodes[re->id].oldParse == toParse)
               break;
-            re->oldParse = toParse;
+            nodes[re->id].oldParse = toParse;
             // making branch
-            if (!re->param0) {
-              insert_stack(&re, &prev, &toParse, &leftenter, rea_True, rea_RangeN_step2,
+            if (!nodes[re->id].param0) {
+              if (re->param0 != -1 && st.memo) {
+                int state = memoState(st, re->param0, toParse);
+                if (state & MEMO_FAILED) {
+                  check_stack(context, false, &re, &prev, &toParse, &leftenter, &action);
+                  continue;
+                }
+                // empty iteration, missed by oldParse check after backtracking
+                if (state & MEMO_ENTERED)
+                  break;
+                memoMark(st, re->param0, toParse, MEMO_ENTERED);
+              }
+              insert_stack(context, &re, &prev, &toParse, &leftenter, rea_True, rea_RangeN_step2,
                            &re->un.param, nullptr, toParse);
               continue;
             }
             else {
               // go into
-              re->param0--;
+              nodes[re->id].param0--;
             }
             re = re->un.param;
             leftenter = true;
             continue;
           case EOps::ReRangeNM:
             if (leftenter) {
-              re->param0 = re->s;
-              re->param1 = re->e - re->s;
-              re->oldParse = -1;
+              nodes[re->id].param0 = re->s;
+              nodes[re->id].param1 = re->e - re->s;
+              nodes[re->id].oldParse = -1;
             }
-            if (!re->param0) {
-              if (re->param1)
-                re->param1--;
+            if (!nodes[re->id].param0) {
+              if (nodes[re->id].param1)
+                nodes[re->id].param1--;
               else {
-                insert_stack(&re, &prev, &toParse, &leftenter, rea_True, rea_False, &re->next, &re,
+                insert_stack(context, &re, &prev, &toParse, &leftenter, rea_True, rea_False, &re->next, &re,
                              toParse);
                 continue;
               }
               {
-                insert_stack(&re, &prev, &toParse, &leftenter, rea_True, rea_RangeNM_step2,
+                insert_stack(context, &re, &prev, &toParse, &leftenter, rea_True, rea_RangeNM_step2,
                              &re->un.param, nullptr, toParse);
                 continue;
               }
             }
             else
-              re->param0--;
+              nodes[re->id].param0--;
             re = re->un.param;
             leftenter = true;
             continue;
           case EOps::ReNGRangeN:
             if (leftenter) {
-              re->param0 = re->s;
-              re->oldParse = -1;
+              nodes[re->id].param0 = re->s;
+              nodes[re->id].oldParse = -1;
             }
-            if (!re->param0 && re->oldParse == toParse)
+            if (!nodes[re->id].param0 && nodes[re->id].oldParse == toParse)
               break;
-            re->oldParse = toParse;
-            if (!re->param0) {
-              insert_stack(&re, &prev, &toParse, &leftenter, rea_True, rea_NGRangeN_step2,
+            nodes[re->id].oldParse = toParse;
+            if (!nodes[re->id].param0) {
+              if (re->param0 != -1 && st.memo) {
+                int state = memoState(st, re->param0, toParse);
+                if (state & MEMO_FAILED) {
+                  check_stack(context, false, &re, &prev, &toParse, &leftenter, &action);
+                  continue;
+                }
+                // empty iteration, missed by oldParse check after backtracking
+                if (state & MEMO_ENTERED)
+                  break;
+                memoMark(st, re->param0, toParse, MEMO_ENTERED);
+              }
+              insert_stack(context, &re, &prev, &toParse, &leftenter, rea_True, rea_NGRangeN_step2,
                            &re->next, &re, toParse);
               continue;
             }
             else
-              re->param0--;
+              nodes[re->id].param0--;
             re = re->un.param;
             leftenter = true;
             continue;
           case EOps::ReNGRangeNM:
             if (leftenter) {
-              re->param0 = re->s;
-              re->param1 = re->e - re->s;
-              re->oldParse = -1;
+              nodes[re->id].param0 = re->s;
+              nodes[re->id].param1 = re->e - re->s;
+              nodes[re->id].oldParse = -1;
             }
-            if (!re->param0) {
-              if (re->param1)
-                re->param1--;
+            if (!nodes[re->id].param0) {
+              if (nodes[re->id].param1)
+                nodes[re->id].param1--;
               else {
-                insert_stack(&re, &prev, &toParse, &leftenter, rea_True, rea_False, &re->next, &re,
+                insert_stack(context, &re, &prev, &toParse, &leftenter, rea_True, rea_False, &re->next, &re,
                              toParse);
                 continue;
               }
               {
-                insert_stack(&re, &prev, &toParse, &leftenter, rea_True, rea_NGRangeNM_step2,
+                insert_stack(context, &re, &prev, &toParse, &leftenter, rea_True, rea_NGRangeNM_step2,
                              &re->next, &re, toParse);
                 continue;
               }
             }
             else
-              re->param0--;
+              nodes[re->id].param0--;
             re = re->un.param;
             leftenter = true;
             continue;
@@ -1296,16 +2000,16 @@ bool CRegExp::lowParse(SRegInfo* re, SRegInfo* prev, int toParse)
 
       switch (action) {
         case rea_False:
-          if (count_elem) {
-            check_stack(false, &re, &prev, &toParse, &leftenter, &action);
+          if (context->count_elem) {
+            check_stack(context, false, &re, &prev, &toParse, &leftenter, &action);
             continue;
           }
           else
             return false;
           break;
         case rea_True:
-          if (count_elem) {
-            check_stack(true, &re, &prev, &toParse, &leftenter, &action);
+          if (context->count_elem) {
+            check_stack(context, true, &re, &prev, &toParse, &leftenter, &action);
             continue;
           }
           else
@@ -1316,40 +2020,53 @@ bool CRegExp::lowParse(SRegInfo* re, SRegInfo* prev, int toParse)
           break;
         case rea_RangeN_step2:
           action = -1;
-          insert_stack(&re, &prev, &toParse, &leftenter, rea_True, rea_False, &re->next, &re,
+          insert_stack(context, &re, &prev, &toParse, &leftenter, rea_True,
+                       re->param0 != -1 ? rea_RangeN_fail : rea_False, &re->next, &re,
                        toParse);  //-V522
           continue;
           break;
         case rea_RangeNM_step2:
           action = -1;
-          insert_stack(&re, &prev, &toParse, &leftenter, rea_True, rea_RangeNM_step3, &re->next,
+          insert_stack(context, &re, &prev, &toParse, &leftenter, rea_True, rea_RangeNM_step3, &re->next,
                        &re, toParse);
           continue;
           break;
         case rea_RangeNM_step3:
           action = -1;  //-V1037
-          re->param1++;
-          check_stack(false, &re, &prev, &toParse, &leftenter, &action);
+          nodes[re->id].param1++;
+          check_stack(context, false, &re, &prev, &toParse, &leftenter, &action);
           continue;
           break;
         case rea_NGRangeN_step2:
           action = -1;
-          if (re->param0)
-            re->param0--;
+          if (nodes[re->id].param0)
+            nodes[re->id].param0--;
+          // the last branch of the decision is marked to record its failure, when memo is used
+          if (re->param0 != -1 && (st.memo || startMemo(st))) {
+            insert_stack(context, &re, &prev, &toParse, &leftenter, rea_True, rea_RangeN_fail,
+                         &re->un.param, nullptr, toParse);
+            continue;
+          }
           re = re->un.param;
           leftenter = true;
           continue;
           break;
         case rea_NGRangeNM_step2:
           action = -1;
-          insert_stack(&re, &prev, &toParse, &leftenter, rea_True, rea_NGRangeNM_step3,
+          insert_stack(context, &re, &prev, &toParse, &leftenter, rea_True, rea_NGRangeNM_step3,
                        &re->un.param, nullptr, toParse);
           continue;
           break;
         case rea_NGRangeNM_step3:
           action = -1;
-          re->param1++;
-          check_stack(false, &re, &prev, &toParse, &leftenter, &action);
+          nodes[re->id].param1++;
+          check_stack(context, false, &re, &prev, &toParse, &leftenter, &action);
+          continue;
+          break;
+        case rea_RangeN_fail:
+          action = -1;
+          memoMark(st, re->param0, toParse, MEMO_FAILED);
+          check_stack(context, false, &re, &prev, &toParse, &leftenter, &action);
           continue;
           break;
       }
@@ -1362,22 +2079,45 @@ bool CRegExp::lowParse(SRegInfo* re, SRegInfo* prev, int toParse)
         leftenter = true;
       }
     }
-    check_stack(true, &re, &prev, &toParse, &leftenter, &action);
+    check_stack(context, true, &re, &prev, &toParse, &leftenter, &action);
   }
 }
 
-inline bool CRegExp::quickCheck(int toParse)
+/**
+  Checks the minimal match length and the first symbol at the position.
+*/
+inline bool CRegExp::isFirstSymbol(UChar c) const
 {
-  if (firstChar != BAD_WCHAR) {
-    if (toParse >= end)
-      return false;
-    if (ignoreCase) {
-      if (UStr::toLowerCase((*global_pattern)[toParse]) != UStr::toLowerCase(firstChar))
-        return false;
-    }
-    else if ((*global_pattern)[toParse] != firstChar)
-      return false;
+  if (ignoreCase)
+    return firstSet->contains(c) || firstSet->contains(UStr::toLowerCase(c)) ||
+           firstSet->contains(UStr::toUpperCase(c));
+  return firstSet->contains(c);
+}
+
+inline bool CRegExp::firstCheck(const MatchState& st, int toParse) const
+{
+  if (minLength && st.end - toParse < minLength)
+    return false;
+  if (!firstSet)
     return true;
+  if (toParse >= st.end)
+    return false;
+  return isFirstSymbol((*st.global_pattern)[toParse]);
+}
+
+inline bool CRegExp::quickCheck(const MatchState& st, int toParse) const
+{
+  if (!firstCheck(st, toParse))
+    return false;
+  // offset of the literal is counted in symbols of one code unit
+  if (literalOffset != -1 &&
+      !(st.surrogates && UStr::hasSurrogates(*st.global_pattern, toParse, toParse + literalOffset)))
+  {
+    int lpos = toParse + literalOffset;
+    if (lpos + requiredLiteral.length() > st.end ||
+        requiredLiteral.compare(0, requiredLiteral.length(), *st.global_pattern, lpos,
+                                requiredLiteral.length()) != 0)
+      return false;
   }
   if (firstMetaChar != EMetaSymbols::ReBadMeta)
     switch (firstMetaChar) {
@@ -1387,7 +2127,7 @@ inline bool CRegExp::quickCheck(int toParse)
         return true;
 #ifdef COLORERMODE
       case EMetaSymbols::ReSoScheme:
-        if (toParse != schemeStart)
+        if (toParse != st.schemeStart)
           return false;
         return true;
 #endif
@@ -1416,17 +2156,129 @@ inline bool CRegExp::quickCheck(int toParse)
   return true;
 }
 
-inline bool CRegExp::parseRE(int pos)
+#ifndef NAMED_MATCHES_IN_HASH
+/**
+  Matches RE of the special kind without the engine.
+*/
+bool CRegExp::directParse(MatchState& st, int toParse) const
+{
+  SMatches* matches = st.matches;
+  matches->cMatch = 1;
+  matches->cnMatch = 0;
+  matches->s[0] = matches->e[0] = -1;
+  const UnicodeString& pattern = *st.global_pattern;
+  int start = -1;
+  int len = 0;
+  switch (kind) {
+    case EReKind::Literal:
+      len = requiredLiteral.length();
+      if (st.positionMoves)
+        start = findLiteral(st, toParse);
+      else if (toParse + len <= st.end &&
+               requiredLiteral.compare(0, len, pattern, toParse, len) == 0)
+        start = toParse;
+      break;
+    case EReKind::EndOfLine:
+      if (st.positionMoves ? toParse <= st.end : toParse == st.end)
+        start = st.end;
+      break;
+#ifdef COLORERMODE
+    case EReKind::BackTrace: {
+      int sv = tree_root->un.param->param0;
+      if (!st.backStr || !st.backTrace || sv == -1)
+        return false;
+      int from = st.backTrace->s[sv];
+      len = st.backTrace->e[sv] - from;
+      // empty or not matched bracket matches at once
+      if (from < 0 || len <= 0) {
+        len = 0;
+        start = toParse;
+        break;
+      }
+      // trace of other string can't be read out of its bounds
+      if (from + len > st.backStr->length())
+        return false;
+      const UChar* text = pattern.getBuffer();
+      const UChar* lit = st.backStr->getBuffer() + from;
+      if (st.positionMoves)
+        start = findString(text, st.end, lit, len, toParse);
+      else if (toParse + len <= st.end && u_memcmp(text + toParse, lit, len) == 0)
+        start = toParse;
+      break;
+    }
+#endif
+    default:
+      break;
+  }
+  if (start == -1)
+    return false;
+  matches->s[0] = start;
+  matches->e[0] = start + len;
+  return true;
+}
+#endif
+
+/**
+  Runs generated matcher at the start positions, which pass the quick checks.
+*/
+bool CRegExp::nativeParse(MatchState& st, int pos) const
+{
+  if (!st.positionMoves && !quickCheck(st, pos))
+    return false;
+  SMatches* matches = st.matches;
+  matches->cMatch = cMatch;
+  matches->cnMatch = cnMatch;
+  SNativeMatch m {};
+  m.text = st.global_pattern->getBuffer();
+  m.end = st.end;
+  m.matches = matches;
+#ifdef COLORERMODE
+  m.schemeStart = st.schemeStart;
+#endif
+  m.surrogates = st.surrogates;
+  m.stepLimit = st.stepLimit;
+  m.steps = st.steps;
+  bool res = false;
+  for (; pos <= st.end && !res && !m.stepLimitHit; pos++) {
+    if (st.positionMoves && !firstCheck(st, pos)) {
+      if (st.end - pos < minLength)
+        break;
+      continue;
+    }
+    // brackets are not restored on backtracking, failed attempt must not leave them
+    m.startChange = m.endChange = false;
+    std::fill_n(matches->s, cMatch, -1);
+    std::fill_n(matches->e, cMatch, -1);
+    std::fill_n(matches->ns, cnMatch, -1);
+    std::fill_n(matches->ne, cnMatch, -1);
+    res = native(m, pos);
+    if (!st.positionMoves)
+      break;
+  }
+  st.steps = m.steps;
+  st.stepLimitHit = m.stepLimitHit;
+  return res;
+}
+
+inline bool CRegExp::parseRE(MatchState& st, int pos, EEngine eng) const
 {
   if (error != EError::EOK)
     return false;
+#ifndef NAMED_MATCHES_IN_HASH
+  // tree engine is left as the reference implementation for all kinds
+  // generated code reads the string up to the end, positions after it are left to the engine
+  if (eng == EEngine::Program && native && pos <= st.end)
+    return nativeParse(st, pos);
+  if (eng == EEngine::Program && kind != EReKind::General)
+    return directParse(st, pos);
+#endif
 
   int toParse = pos;
 
-  if (!positionMoves && (firstChar != BAD_WCHAR || firstMetaChar != EMetaSymbols::ReBadMeta) &&
-      !quickCheck(toParse))
+  if (!st.positionMoves && !quickCheck(st, toParse))
     return false;
 
+  SMatches* matches = st.matches;
   int i;
   for (i = 0; i < cMatch; i++) matches->s[i] = matches->e[i] = -1;
   matches->cMatch = cMatch;
@@ -1434,40 +2286,181 @@ inline bool CRegExp::parseRE(int pos)
   for (i = 0; i < cnMatch; i++) matches->ns[i] = matches->ne[i] = -1;
   matches->cnMatch = cnMatch;
 #endif
+  RegExpContext* context = st.context;
+  if (context->nodes.size() < static_cast<size_t>(nodeCount))
+    context->nodes.resize(nodeCount);
+  st.nodes = context->nodes.data();
+  // offset of the literal is counted in symbols of one code unit
+  int literal_offset = st.surrogates ? -1 : literalOffset;
+  int literal_pos = -1;
+  if (st.positionMoves && !requiredLiteral.isEmpty()) {
+    literal_pos = findLiteral(st, toParse + (literal_offset == -1 ? 0 : literal_offset));
+    if (literal_pos == -1)
+      return false;
+  }
+#ifndef NAMED_MATCHES_IN_HASH
+  // tree engine is left without prefilter, as the reference implementation
+  bool prefilter = eng == EEngine::Program && !nfa.empty();
+  // start positions are known from the literal with fixed offset, DFA search is not needed
+  if (prefilter && st.positionMoves && literal_offset == -1 && !dfaCheck(st, toParse, true))
+    return false;
+#endif
+  bool tried = false;
   do {
-    // stack=null;
-    if (lowParse(tree_root, nullptr, toParse))
+    if (st.positionMoves && !requiredLiteral.isEmpty()) {
+      int from = toParse + (literal_offset == -1 ? 0 : literal_offset);
+      if (literal_pos < from)
+        literal_pos = findLiteral(st, from);
+      if (literal_pos == -1)
+        return false;
+      // jump to the only possible start before the literal
+      if (literal_offset != -1 && literal_pos - literal_offset > toParse)
+        toParse = pos = literal_pos - literal_offset;
+    }
+    if (st.positionMoves && !firstCheck(st, toParse)) {
+      if (st.end - toParse < minLength)
+        return false;
+      toParse = ++pos;
+      continue;
+    }
+#ifndef NAMED_MATCHES_IN_HASH
+    if (prefilter && !dfaCheck(st, toParse, false)) {
+      if (!st.positionMoves)
+        return false;
+      toParse = ++pos;
+      continue;
+    }
+#endif
+    // brackets of the failed attempt from previous position must not be seen
+    if (tried) {
+      st.startChange = st.endChange = false;
+      for (i = 0; i < cMatch; i++) matches->s[i] = matches->e[i] = -1;
+#ifndef NAMED_MATCHES_IN_HASH
+      for (i = 0; i < cnMatch; i++) matches->ns[i] = matches->ne[i] = -1;
+#endif
+    }
+    tried = true;
+    context->count_elem = 0;
+    if (eng == EEngine::Program ? programParse(st, toParse)
+                                : lowParse(st, tree_root, nullptr, toParse))
       return true;
-    if (!positionMoves)
+    if (!st.positionMoves || st.stepLimitHit)
       return false;
     toParse = ++pos;
-  } while (toParse <= end);
+  } while (toParse <= st.end);
   return false;
 }
 
+bool CRegExp::run(MatchState& st, int pos) const
+{
+  st.stepLimit = stepLimit ? stepLimit : st.context->step_limit;
+  // moving search scans the rest of the string anyway, single position is checked with pairs
+  st.surrogates = codePoints && st.context->surrogate_free != st.global_pattern &&
+                  (!st.positionMoves || UStr::hasSurrogates(*st.global_pattern, pos, st.end));
+  bool res;
+  if (RegExpProfile* profile = st.context->profile) {
+    // steps are counted only with the limit
+    if (!st.stepLimit)
+      st.stepLimit = INT_MAX;
+    st.context->peak_elem = 0;
+    auto started = std::chrono::steady_clock::now();
+    res = runEngines(st, pos);
+    auto time = std::chrono::steady_clock::now() - started;
+    SRegExpStat& stat = profile->stats[this];
+    stat.calls++;
+    stat.matches += res;
+    stat.nanoseconds += std::chrono::duration_cast<std::chrono::nanoseconds>(time).count();
+    stat.steps += st.steps;
+    stat.depth = std::max(stat.depth, st.context->peak_elem);
+  }
+  else
+    res = runEngines(st, pos);
+  if (st.stepLimitHit) {
+    stepLimitHits++;
+    st.context->last_result = EMatchResult::StepLimit;
+  }
+  else
+    st.context->last_result = res ? EMatchResult::Match : EMatchResult::NoMatch;
+  return res;
+}
+
+bool CRegExp::runEngines(MatchState& st, int pos) const
+{
+#ifdef NAMED_MATCHES_IN_HASH
+  return parseRE(st, pos, EEngine::Tree);
+#elif defined COLORER_USE_REGEXP_CHECK
+  // runs both engines and reports the difference
+  SMatches tree_matches = *st.matches;
+  MatchState tree_st = st;
+  tree_st.matches = &tree_matches;
+  bool tree_res = parseRE(tree_st, pos, EEngine::Tree);
+  bool res = parseRE(st, pos, EEngine::Program);
+  // results of the abandoned match are not comparable, engines make different steps
+  bool same = res == tree_res || st.stepLimitHit || tree_st.stepLimitHit;
+  if (same && res && tree_res) {
+    for (int i = 0; i < cMatch; i++)
+      same = same && st.matches->s[i] == tree_matches.s[i] && st.matches->e[i] == tree_matches.e[i];
+    for (int i = 0; i < cnMatch; i++)
+      same = same && st.matches->ns[i] == tree_matches.ns[i] &&
+             st.matches->ne[i] == tree_matches.ne[i];
+  }
+  if (!same) {
+    spdlog::error("[CRegExp] engines mismatch on line \"{0}\", position {1}", *st.global_pattern,
+                  pos);
+  }
+  if (engine == EEngine::Tree) {
+    st.stepLimitHit = tree_st.stepLimitHit;
+    return tree_res;
+  }
+  return res;
+#else
+  return parseRE(st, pos, engine);
+#endif
+}
+
+#ifndef NAMED_MATCHES_IN_HASH
+#ifdef COLORERMODE
+bool CRegExp::parse(const UnicodeString* str, int pos, int eol, SMatches* mtch, int soScheme,
+                    int posMoves, const UnicodeString* bkstr, const SMatches* bktrace,
+                    RegExpContext* ctx) const
+{
+  MatchState st {};
+  st.global_pattern = str;
+  st.end = eol;
+  st.matches = mtch;
+  st.backStr = bkstr;
+  st.backTrace = bktrace;
+  st.schemeStart = soScheme;
+  st.positionMoves = posMoves != -1 ? (posMoves != 0) : positionMoves;
+  st.context = ctx ? ctx : RegExpContext::getThreadContext();
+  return run(st, pos);
+}
+#endif
+#endif
+
 bool CRegExp::parse(const UnicodeString* str, int pos, int eol, SMatches* mtch
 #ifdef NAMED_MATCHES_IN_HASH
                     ,
                     PMatchHash nmtch
 #endif
                     ,
-                    int soScheme, int posMoves)
+                    int soScheme, int posMoves, RegExpContext* ctx) const
 {
-  bool nms = positionMoves;
-  if (posMoves != -1)
-    positionMoves = (posMoves != 0);
-#ifdef COLORERMODE
-  schemeStart = soScheme;
-#endif
-  global_pattern = str;
-  end = eol;
-  matches = mtch;
+  MatchState st {};
+  st.global_pattern = str;
+  st.end = eol;
+  st.matches = mtch;
 #ifdef NAMED_MATCHES_IN_HASH
-  namedMatches = nmtch;
+  st.namedMatches = nmtch;
 #endif
-  bool result = parseRE(pos);
-  positionMoves = nms;
-  return result;
+#ifdef COLORERMODE
+  st.backStr = backStr;
+  st.backTrace = backTrace;
+  st.schemeStart = soScheme;
+#endif
+  st.positionMoves = posMoves != -1 ? (posMoves != 0) : positionMoves;
+  st.context = ctx ? ctx : RegExpContext::getThreadContext();
+  return run(st, pos);
 }
 
 bool CRegExp::parse(const UnicodeString* str, SMatches* mtch
@@ -1475,18 +2468,24 @@ bool CRegExp::parse(const UnicodeString* str, SMatches* mtch
                     ,
                     PMatchHash nmtch
 #endif
-)
+                    ,
+                    RegExpContext* ctx) const
 {
-  end = str->length();
-  global_pattern = str;
-#ifdef COLORERMODE
-  schemeStart = 0;
-#endif
-  matches = mtch;
+  MatchState st {};
+  st.global_pattern = str;
+  st.end = str->length();
+  st.matches = mtch;
 #ifdef NAMED_MATCHES_IN_HASH
-  namedMatches = nmtch;
+  st.namedMatches = nmtch;
+#endif
+#ifdef COLORERMODE
+  st.backStr = backStr;
+  st.backTrace = backTrace;
+  st.schemeStart = 0;
 #endif
-  return parseRE(0);
+  st.positionMoves = positionMoves;
+  st.context = ctx ? ctx : RegExpContext::getThreadContext();
+  return run(st, 0);
 }
 
 /////////////////////////////////////////////////////////////////
@@ -1506,15 +2505,79 @@ bool CRegExp::setRE(const UnicodeString* re)
 #endif
   return error == EError::EOK;
 }
-bool CRegExp::isOk()
+bool CRegExp::canStartWith(UChar c) const
+{
+  if (error != EError::EOK || positionMoves || !firstSet)
+    return true;
+  return isFirstSymbol(c);
+}
+bool CRegExp::isOk() const
 {
   return error == EError::EOK;
 }
-EError CRegExp::getError()
+EError CRegExp::getError() const
 {
   return error;
 }
 
+void CRegExp::setEngine(EEngine eng)
+{
+  engine = eng;
+}
+
+EEngine CRegExp::getEngine() const
+{
+  return engine;
+}
+
+EReKind CRegExp::getKind() const
+{
+  return kind;
+}
+
+void CRegExp::setStepLimit(int limit)
+{
+  stepLimit = limit;
+}
+
+int CRegExp::getStepLimit() const
+{
+  return stepLimit;
+}
+
+#ifndef NAMED_MATCHES_IN_HASH
+void CRegExp::setNative(CRegExpNative fn)
+{
+  native = fn;
+}
+
+static std::unordered_map<UnicodeString, CRegExpNative>& nativeRegistry()
+{
+  static std::unordered_map<UnicodeString, CRegExpNative> registry;
+  return registry;
+}
+
+bool CRegExp::registerNative(const UnicodeString& pattern, CRegExpNative fn)
+{
+  nativeRegistry()[pattern] = fn;
+  return true;
+}
+
+CRegExpNative CRegExp::findNative(const UnicodeString& pattern)
+{
+  auto& registry = nativeRegistry();
+  if (registry.empty())
+    return nullptr;
+  auto it = registry.find(pattern);
+  return it == registry.end() ? nullptr : it->second;
+}
+#endif
+
+unsigned int CRegExp::getStepLimitHits() const
+{
+  return stepLimitHits;
+}
+
 bool CRegExp::setPositionMoves(bool moves)
 {
   positionMoves = moves;
@@ -1523,20 +2586,18 @@ bool CRegExp::setPositionMoves(bool moves)
 
 void CRegExp::clearRegExpStack()
 {
-  CRegExp::RegExpStack_Size = 0;
-  delete[] CRegExp::RegExpStack;
-  CRegExp::RegExpStack = nullptr;
+  RegExpContext::getThreadContext()->clear();
 }
 
 #ifndef NAMED_MATCHES_IN_HASH
-int CRegExp::getBracketNo(const UnicodeString* brname)
+int CRegExp::getBracketNo(const UnicodeString* brname) const
 {
   for (int brn = 0; brn < cnMatch; brn++)
     if (brname->caseCompare(*brnames[brn], 0) == 0)
       return brn;
   return -1;
 }
-UnicodeString* CRegExp::getBracketName(int no)
+const UnicodeString* CRegExp::getBracketName(int no) const
 {
   if (no >= cnMatch)
     return nullptr;
@@ -1545,7 +2606,7 @@ UnicodeString* CRegExp::getBracketName(int no)
 #endif
 
 #ifdef COLORERMODE
-bool CRegExp::setBackRE(CRegExp* bkre)
+bool CRegExp::setBackRE(const CRegExp* bkre)
 {
   this->backRE = bkre;
   return true;
@@ -1563,4 +2624,36 @@ bool CRegExp::getBackTrace(const UnicodeString** str, SMatches** trace)
   return true;
 }
 
+bool CRegExp::hasBackTrace() const
+{
+  return backTraceBrackets || backTraceNamed;
+}
+
+void CRegExp::copyBackTrace(const UnicodeString& str, const SMatches& trace, UnicodeString& bkstr,
+                            SMatches& bktrace) const
+{
+  bkstr.remove();
+  bktrace.cMatch = trace.cMatch;
+  bktrace.cnMatch = trace.cnMatch;
+  // only the used brackets of the trace are valid, see SMatches::copyUsed
+  for (int i = 0; i < MATCHES_NUM; i++) {
+    bktrace.s[i] = bktrace.e[i] = -1;
+    if (!(backTraceBrackets & (1u << i)) || i >= std::max(trace.cMatch, 1) || trace.s[i] < 0 ||
+        trace.e[i] < trace.s[i])
+      continue;
+    bktrace.s[i] = bkstr.length();
+    bkstr.append(str, trace.s[i], trace.e[i] - trace.s[i]);
+    bktrace.e[i] = bkstr.length();
+  }
+  for (int i = 0; i < NAMED_MATCHES_NUM; i++) {
+    bktrace.ns[i] = bktrace.ne[i] = -1;
+    if (!(backTraceNamed & (1u << i)) || i >= trace.cnMatch || trace.ns[i] < 0 ||
+        trace.ne[i] < trace.ns[i])
+      continue;
+    bktrace.ns[i] = bkstr.length();
+    bkstr.append(str, trace.ns[i], trace.ne[i] - trace.ns[i]);
+    bktrace.ne[i] = bkstr.length();
+  }
+}
+
 #endif
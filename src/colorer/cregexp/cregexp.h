@@ -2,7 +2,16 @@
 #define COLORER_CREGEXP_H
 
 #include <unicode/uniset.h>
+#include <unicode/utf16.h>
+#include <algorithm>
+#include <atomic>
+#include <map>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
 #include "colorer/Common.h"
+#include "colorer/common/CharacterClass.h"
 
 /**
     @addtogroup cregexp Regular Expressions
@@ -130,6 +139,23 @@ struct SMatches
   int ne[NAMED_MATCHES_NUM];
   int cnMatch;
 #endif
+
+  /**
+    Copies only the brackets of the match (zero bracket is always copied),
+    the rest of slots is left unchanged.
+  */
+  void copyUsed(const SMatches& other)
+  {
+    cMatch = other.cMatch;
+    int count = std::max(cMatch, 1);
+    std::copy_n(other.s, count, s);
+    std::copy_n(other.e, count, e);
+#if !defined NAMED_MATCHES_IN_HASH
+    cnMatch = other.cnMatch;
+    std::copy_n(other.ns, cnMatch, ns);
+    std::copy_n(other.ne, cnMatch, ne);
+#endif
+  }
 };
 
 /** Regular expressions internal tree node.
@@ -145,7 +171,7 @@ class SRegInfo
     EMetaSymbols metaSymbol;
     UChar symbol;
     UnicodeString* word;
-    icu::UnicodeSet* charclass;
+    CharacterClass* charclass;
     SRegInfo* param;
   } un;
 #if defined NAMED_MATCHES_IN_HASH
@@ -154,15 +180,34 @@ class SRegInfo
   SRegInfo* parent = nullptr;
   SRegInfo* next = nullptr;
   SRegInfo* prev = nullptr;
-  int oldParse = 0;
+  // bracket number, backward look length or backreference number,
+  // for ReWord with //i - 1 if the word is stored case folded,
+  // for ReRangeN and ReNGRangeN - slot of the range states memo or -1
   int param0 = 0;
-  int param1 = 0;
+  // bounds of the ranges {s,e}
   int s = 0;
   int e = 0;
+  // index of the node in the tree, used to address SRegState
+  int id = 0;
 
   EOps op = EOps::ReEmpty;
 };
 
+/** Matching scratch of a single tree node.
+    Kept outside of SRegInfo, so the compiled tree is not changed while matching.
+    @ingroup cregexp
+*/
+struct SRegState
+{
+  // start position of the brackets
+  int s;
+  // ranges counters
+  int param0;
+  int param1;
+  // position of the last range iteration
+  int oldParse;
+};
+
 struct StackElem
 {
   // local variable
@@ -176,8 +221,278 @@ struct StackElem
   int ifFalseReturn;
 };
 
+/** Operation codes of the compiled RE program.
+    Tree operations are specialized with the compile time known flags.
+    @ingroup cregexp
+*/
+enum class EReCode : unsigned char {
+  ReEmpty,
+  ReGroup,          // (?{} ...) (?: ...) - brackets without capture
+  ReBrackets,       // (...)
+  ReNamedBrackets,  // (?{name} ...)
+  ReSymb,           // a
+  ReSymbNoCase,     // a with //i
+  ReWord,           // word
+  ReWordNoCase,     // word with //i
+  ReWordFold,       // case folded word with //i
+  ReMetaSymb,       // \W \s \d ...
+  ReEnum,           // []
+  ReNEnum,          // [^]
+#ifdef COLORERMODE
+  ReBkTrace,       // \yN
+  ReBkTraceN,      // \YN
+  ReBkTraceName,   // \y{name}
+  ReBkTraceNName,  // \Y{name}
+#endif
+  ReBkBrack,      // \N
+  ReBkBrackName,  // \p{name}
+  ReAhead,        // ?=
+  ReNAhead,       // ?!
+  ReBehind,       // ?#n
+  ReNBehind,      // ?~n
+  ReOr,           // |
+  ReRangeN,       // {n,}
+  ReRangeNM,      // {n,m}
+  ReNGRangeN,     // {n,}?
+  ReNGRangeNM     // {n,m}?
+};
+
+/** Instruction of the compiled RE program.
+    The program is the flat copy of SRegInfo tree, where instruction index is SRegInfo::id
+    and links are indexes in the program (-1 - no link).
+    @ingroup cregexp
+*/
+struct SReInstr
+{
+  EReCode op;
+  // true, if the successor is the next node (it is entered),
+  // false - if it is the parent node (it is leaved)
+  bool nextEnter;
+  // symbol; lower case symbol for ReSymbNoCase
+  UChar symbol;
+  // upper case symbol for ReSymbNoCase
+  UChar symbol2;
+  // node, executed after this one
+  int next;
+  int child;
+  // node to leave into after the alternative of ReOr
+  int leave;
+  int param0;
+  int s;
+  int e;
+  union {
+    EMetaSymbols metaSymbol;
+    const UnicodeString* word;
+    const CharacterClass* charclass;
+  } un;
+};
+
+/** Backtracking stack element of the compiled RE program.
+    @ingroup cregexp
+*/
+struct SReFrame
+{
+  int re;
+  int toParse;
+  bool leftenter;
+  // step if function return true
+  char ifTrueReturn;
+  // step if function return false
+  char ifFalseReturn;
+};
+
+/** Operation codes of NFA, built for the DFA prefilter of CRegExp.
+    @ingroup cregexp
+*/
+enum class ENfaOp : unsigned char {
+  NfaSymb,        // ch
+  NfaSymbNoCase,  // ch - lower case, ch2 - upper case symbol
+  NfaSymbFold,    // ch - case folded symbol
+  NfaEnum,        // []
+  NfaNEnum,       // [^]
+  NfaMetaSymb,    // \w \d ...
+  NfaAny,         // any code unit
+  NfaAssert,      // zero width metasymbol ^ $ \b ...
+  NfaSplit,       // goes to out and out1
+  NfaMatch
+};
+
+/** NFA state.
+    @ingroup cregexp
+*/
+struct SNfaState
+{
+  ENfaOp op;
+  EMetaSymbols metaSymbol;
+  UChar ch;
+  UChar ch2;
+  const CharacterClass* charclass;
+  int out;
+  int out1;
+};
+
+// size of the transitions table of DFA state, indexed by code unit
+#define DFA_DIRECT_SIZE 128
+// maximum count of DFA states for one RE
+#define DFA_MAX_STATES 512
+// maximum count of DFA states in the context
+#define DFA_MAX_TOTAL_STATES 8192
+// size of the cache of transitions by other code units
+#define DFA_RECENT_SIZE 256
+
+/** Lazily built DFA state: the set of NFA states with the flags of previous symbol.
+    @ingroup cregexp
+*/
+struct SDfaState
+{
+  std::vector<int> nfa;
+  int flags;
+  // 'dead' state has no NFA states and can't reach the match
+  bool dead;
+  // -1 - unknown, 0/1 - is the match possible at the end of line
+  signed char acceptEnd;
+  // transitions: -1 - unknown, (next_state << 1) | (is the match possible before symbol)
+  int next[DFA_DIRECT_SIZE];
+};
+
+/** DFA states cache of the single CRegExp, stored in RegExpContext.
+    @ingroup cregexp
+*/
+struct SDfaCache
+{
+  std::vector<std::unique_ptr<SDfaState>> states;
+  std::map<std::pair<int, std::vector<int>>, int> index;
+  // initial states, by [search][flags]
+  int start[2][16];
+  struct
+  {
+    int state;
+    int c;
+    int result;
+  } recent[DFA_RECENT_SIZE];
+
+  SDfaCache();
+};
+
 #define INIT_MEM_SIZE 512
 #define MEM_INC 128
+// count of the failed range states in the parse call, after which they are memoized
+#define MEMO_MIN_FAILS 16
+// range states memo bits: the decision is on the backtracking stack, the decision failed
+#define MEMO_ENTERED 1
+#define MEMO_FAILED 2
+
+/** Result of the last RE parse call with the context.
+    @ingroup cregexp
+*/
+enum class EMatchResult {
+  NoMatch,   // RE doesn't match
+  Match,     // RE matches
+  StepLimit  // matching is abandoned, limit of the steps is reached
+};
+
+class CRegExp;
+
+/** Statistics of the parse calls of the single RE.
+    @ingroup cregexp
+*/
+struct SRegExpStat
+{
+  unsigned int calls = 0;
+  unsigned int matches = 0;
+  uint64_t nanoseconds = 0;
+  // matching steps of all calls and maximal depth of the backtracking stack
+  uint64_t steps = 0;
+  int depth = 0;
+};
+
+/** Statistics of the parse calls by RE, collected by the context with
+    RegExpContext::setProfile. REs must outlive the profile, it keeps their addresses.
+    @ingroup cregexp
+*/
+struct RegExpProfile
+{
+  std::unordered_map<const CRegExp*, SRegExpStat> stats;
+};
+
+/** Matching context of CRegExp.
+    Holds the backtracking stack and the tree nodes scratch, used by CRegExp::parse.
+    The context is owned by the caller (for example, TextParser) or by the thread.
+    Single context must not be used by several threads at the same time.
+    @ingroup cregexp
+*/
+class RegExpContext
+{
+ public:
+  RegExpContext() = default;
+  ~RegExpContext();
+
+  /**
+    Frees memory, used by the backtracking stack.
+  */
+  void clear();
+
+  /**
+    Returns default context of the calling thread.
+  */
+  static RegExpContext* getThreadContext();
+
+  /**
+    Sets maximum number of matching steps of the single parse call, 0 - no limit.
+    It is used for RE without own limit, see CRegExp::setStepLimit.
+  */
+  void setStepLimit(int limit);
+  int getStepLimit() const;
+  /**
+    Marks the string without surrogate code units, parse calls with it don't check
+    surrogate pairs. Mark is valid until the string is changed or other one is marked.
+  */
+  void setSurrogateFree(const UnicodeString* str);
+  /**
+    Starts collecting statistics of the parse calls into @c profile, null stops it.
+  */
+  void setProfile(RegExpProfile* profile);
+  /**
+    Returns result of the last parse call with this context.
+  */
+  EMatchResult getLastResult() const;
+
+  RegExpContext(const RegExpContext&) = delete;
+  RegExpContext& operator=(const RegExpContext&) = delete;
+  RegExpContext(RegExpContext&&) = delete;
+  RegExpContext& operator=(RegExpContext&&) = delete;
+
+ private:
+  friend class CRegExp;
+
+  /**
+    Drops DFA cache of the RE, or all caches, if total states limit is reached.
+  */
+  void dfaFlush(unsigned int id);
+
+  StackElem* stack = nullptr;
+  int stack_size = 0;
+  SReFrame* frames = nullptr;
+  int frames_size = 0;
+  int count_elem = 0;
+  // maximal count_elem of the call, reset by the profiled calls only
+  int peak_elem = 0;
+  std::vector<SRegState> nodes;
+  // DFA caches by CRegExp::dfaId
+  std::unordered_map<unsigned int, std::unique_ptr<SDfaCache>> dfa;
+  int dfa_states = 0;
+  // NFA states marks, used while building DFA states
+  std::vector<int> nfa_marks;
+  int nfa_mark = 0;
+  // bits of the range states, by memo slot and position; the buffer is kept between
+  // the parse calls, only the words, written by the last call, are cleared
+  std::vector<uint64_t> memo;
+  std::vector<size_t> memo_words;
+  const UnicodeString* surrogate_free = nullptr;
+  RegExpProfile* profile = nullptr;
+  int step_limit = 0;
+  EMatchResult last_result = EMatchResult::NoMatch;
+};
 
 enum ReAction {
   rea_False = 0,
@@ -188,8 +503,117 @@ enum ReAction {
   rea_RangeN_step2,
   rea_NGRangeN_step2,
   rea_NGRangeNM_step2,
-  rea_NGRangeNM_step3
+  rea_NGRangeNM_step3,
+  rea_RangeN_fail
+};
+/** Matching engine of CRegExp.
+    @ingroup cregexp
+*/
+enum class EEngine {
+  // walks SRegInfo tree
+  Tree,
+  // runs compiled flat program
+  Program
+};
+/** Kind of RE by its structure. Program engine matches
+    the special kinds directly, without the program run.
+    @ingroup cregexp
+*/
+enum class EReKind {
+  // needs the matching engine
+  General,
+  // case sensitive string or symbol
+  Literal,
+  // end of line anchor $ only
+  EndOfLine,
+  // case sensitive backtrace \yN only
+  BackTrace
+};
+
+/** Kind of the ambiguous repeat, see CRegExp::findAmbiguities.
+    @ingroup cregexp
+*/
+enum class EReAmbiguity {
+  // repeated chain can end with the repeat, which continues into the next iteration: (a+)+ (\w+\s?)*
+  NestedRepeat,
+  // alternatives of the repeated chain can match the same text: (\w|\d)* (a|aa)*
+  OverlappingOr
+};
+
+/** Ambiguous repeat of RE. Failing match tries all the ways to split the text
+    between the iterations of such repeat.
+    @ingroup cregexp
+*/
+struct SReAmbiguity
+{
+  EReAmbiguity kind;
+  // bounds of the repeat {s,e}, e is -1 for the unbounded repeat
+  int s;
+  int e;
+  // repeat has no range states memo and is not bounded by a few iterations,
+  // matching time can grow exponentially
+  bool exponential;
 };
+
+/** State of the generated matcher call, see CRegExp::generateNative.
+    @ingroup cregexp
+*/
+struct SNativeMatch
+{
+  const UChar* text;
+  int end;
+  SMatches* matches;
+  int schemeStart;
+  // string may have surrogate pairs, which are matched as one symbol
+  bool surrogates;
+  // zero bracket is changed by \m \M
+  bool startChange;
+  bool endChange;
+  bool stepLimitHit;
+  // steps limit (0 - no limit) and count of the steps
+  int stepLimit;
+  int steps;
+
+  bool step()
+  {
+    if (stepLimit && ++steps > stepLimit) {
+      stepLimitHit = true;
+      return false;
+    }
+    return true;
+  }
+
+  /**
+    Returns code point of the surrogate pair at the position,
+    or 0 if there is no pair or the pairs are not checked.
+  */
+  UChar32 supplementaryAt(int pos) const
+  {
+    if (!U16_IS_LEAD(text[pos]) || !surrogates || pos + 1 >= end || !U16_IS_TRAIL(text[pos + 1]))
+      return 0;
+    return U16_GET_SUPPLEMENTARY(text[pos], text[pos + 1]);
+  }
+
+  /**
+    Returns the end of the symbol of the class (or out of it, if @c inverse)
+    at the position, or -1.
+  */
+  int checkClass(const CharacterClass& cc, bool inverse, int pos) const
+  {
+    if (pos >= end)
+      return -1;
+    if (UChar32 sc = supplementaryAt(pos))
+      return cc.containsSupplementary(sc) == inverse ? -1 : pos + 2;
+    return cc.contains(text[pos]) == inverse ? -1 : pos + 1;
+  }
+};
+
+/** Matcher of the single RE, generated by CRegExp::generateNative.
+    Matches at the position only, brackets are prepared by the caller.
+    @ingroup cregexp
+*/
+using CRegExpNative = bool (*)(SNativeMatch& m, int pos);
+
 /** Regular Expression compiler and matcher.
     Colorer regular expressions library cregexp.
 
@@ -239,10 +663,29 @@ enum ReAction {
 \par 2. Dislikes:
 
 \par 2.1. According to Unicode RE level 1 support:
-   - No surrogate symbols support,
+   - Surrogate pair is the single symbol only for . [] \\w \\W operators,
+     others work with the code units,
    - No string length changes on case mappings (only 1 <-> 1 mappings),
 \par 2.2. Algorithmic problems:
    - Stack recursion implementation.
+   - Compiled RE is kept in two forms: SRegInfo tree and the flat program
+     of SReInstr, built from the tree. Program is used for matching by default.
+   - REs without backreferences and look ahead/behind operators also get NFA.
+     Before running the program, lazily built DFA checks, if the match is
+     possible at all, so the hopeless positions are rejected in linear time.
+   - Set of possible first symbols and minimal match length are computed
+     once for RE and reject the start positions before any matching.
+   - Case sensitive RE with the required literal jumps to its occurrences,
+     when position moves.
+   - Surrogate pairs are checked only in the strings with surrogates, lines
+     marked with RegExpContext::setSurrogateFree are matched by code units.
+   - REs without backreferences and repeated groups can be translated
+     into C++ with #generateNative. Compiled into the application,
+     generated matchers are registered by the patterns with #registerNative
+     and are used instead of the engines for the REs of the same patterns.
+   - Compiled RE is not changed by #parse, so single object can be used from
+     several threads, but only if each thread uses its own RegExpContext and
+     the setters (#setRE, #setPositionMoves, #setBackTrace) are not called.
 
     @ingroup cregexp
 */
@@ -263,27 +706,48 @@ class CRegExp
   /**
     Is compilied RE well-formed.
   */
-  bool isOk();
+  bool isOk() const;
 
   /**
     Returns information about RE compilation error.
   */
-  EError getError();
+  EError getError() const;
 
   /**
     Tells RE parser, that it must make moves on tested string while RE matching.
   */
   bool setPositionMoves(bool moves);
+  /**
+    Selects matching engine. Both engines have the same results.
+  */
+  void setEngine(EEngine eng);
+  EEngine getEngine() const;
+  /**
+    Returns kind of RE, known after compilation.
+  */
+  EReKind getKind() const;
+  /**
+    Sets maximum number of matching steps of the single parse call,
+    0 - limit of the matching context is used.
+    When the limit is reached, match is abandoned, parse returns false and
+    the context has EMatchResult::StepLimit result.
+  */
+  void setStepLimit(int limit);
+  int getStepLimit() const;
+  /**
+    Returns count of the parse calls, abandoned by the steps limit.
+  */
+  unsigned int getStepLimitHits() const;
   /**
     Returns count of named brackets.
   */
-  int getBracketNo(const UnicodeString* brname);
+  int getBracketNo(const UnicodeString* brname) const;
   /**
     Returns named bracked name by it's index.
   */
-  UnicodeString* getBracketName(int no);
+  const UnicodeString* getBracketName(int no) const;
 #ifdef COLORERMODE
-  bool setBackRE(CRegExp* bkre);
+  bool setBackRE(const CRegExp* bkre);
   /**
     Changes RE object, used for backreferences with named \y{} \Y{} operators.
   */
@@ -292,52 +756,128 @@ class CRegExp
     Returns current RE object, used for backreferences with \y \Y operators.
   */
   bool getBackTrace(const UnicodeString** str, SMatches** trace);
+  /**
+    Checks, if RE has \y \Y operators, which read the backreferences source.
+  */
+  bool hasBackTrace() const;
+  /**
+    Copies the brackets of @c trace, which are read by \y \Y operators of this RE,
+    from @c str into @c bkstr. Positions of the copies are set into @c bktrace,
+    so the pair can be used as backreferences source instead of the whole @c str.
+  */
+  void copyBackTrace(const UnicodeString& str, const SMatches& trace, UnicodeString& bkstr,
+                     SMatches& bktrace) const;
 #endif
   /**
     Compiles specified regular expression and drops all
     previous structures.
   */
   bool setRE(const UnicodeString* re);
+  /**
+    Checks, if the match, which starts at the symbol @c c, is possible.
+    Returns false only for RE without position moves, which can't start with this symbol,
+    so caller may skip the parse call.
+  */
+  bool canStartWith(UChar c) const;
+  /**
+    Finds the repeats, which can make the backtracking blow up on the failing matches.
+    Analysis is structural and can report the repeats, which are not really ambiguous.
+  */
+  std::vector<SReAmbiguity> findAmbiguities() const;
+#ifndef NAMED_MATCHES_IN_HASH
+  /**
+    Generates C++ code of the matcher function @c name for this RE.
+    Returns false, if RE has the operators, which are not supported by the generator.
+  */
+  bool generateNative(std::string& code, const std::string& name) const;
+  /**
+    Sets generated matcher of this RE, null returns matching to the engines.
+  */
+  void setNative(CRegExpNative fn);
+  /**
+    Registers generated matcher of the RE pattern, see #findNative.
+  */
+  static bool registerNative(const UnicodeString& pattern, CRegExpNative fn);
+  /**
+    Returns generated matcher, registered for the pattern, or null.
+  */
+  static CRegExpNative findNative(const UnicodeString& pattern);
+#endif
 #ifdef NAMED_MATCHES_IN_HASH
   /** Runs RE parser against input string @c str
    */
-  bool parse(const UnicodeString* str, SMatches* mtch, SMatchHash* nmtch = nullptr);
+  bool parse(const UnicodeString* str, SMatches* mtch, SMatchHash* nmtch = nullptr,
+             RegExpContext* ctx = nullptr) const;
   /** Runs RE parser against input string @c str
    */
   bool parse(const UnicodeString* str, int pos, int eol, SMatches* mtch,
-             SMatchHash* nmtch = nullptr, int soscheme = 0, int moves = -1);
+             SMatchHash* nmtch = nullptr, int soscheme = 0, int moves = -1,
+             RegExpContext* ctx = nullptr) const;
 #else
   /** Runs RE parser against input string @c str
+      @param ctx Matching context, if null - default context of the calling thread is used.
    */
-  bool parse(const UnicodeString* str, SMatches* mtch);
+  bool parse(const UnicodeString* str, SMatches* mtch, RegExpContext* ctx = nullptr) const;
   /** Runs RE parser against input string @c str
+      @param ctx Matching context, if null - default context of the calling thread is used.
    */
   bool parse(const UnicodeString* str, int pos, int eol, SMatches* mtch, int soscheme = 0,
-             int moves = -1);
+             int moves = -1, RegExpContext* ctx = nullptr) const;
+#ifdef COLORERMODE
+  /** Runs RE parser against input string @c str with the explicit
+      backreferences source for \y \Y operators, instead of one, set with #setBackTrace.
+      @param ctx Matching context, if null - default context of the calling thread is used.
+   */
+  bool parse(const UnicodeString* str, int pos, int eol, SMatches* mtch, int soscheme, int moves,
+             const UnicodeString* bkstr, const SMatches* bktrace,
+             RegExpContext* ctx = nullptr) const;
+#endif
 #endif
 
  private:
+  // state of the single parse call
+  struct MatchState;
+
   bool ignoreCase = false;
   bool extend = false;
   bool positionMoves = false;
   bool singleLine = false;
   bool multiLine = false;
   SRegInfo* tree_root = nullptr;
+  int nodeCount = 0;
+  std::vector<SReInstr> program;
+  EEngine engine = EEngine::Program;
+  int stepLimit = 0;
+  mutable std::atomic<unsigned int> stepLimitHits {0};
+  // count of the ranges with the states memo
+  int memoCount = 0;
+  // NFA of the DFA prefilter, empty if RE is not suitable for it
+  std::vector<SNfaState> nfa;
+  int nfaStart = -1;
+  int nfaSearch = -1;
+  bool nfaAsserts = false;
+  unsigned int dfaId = 0;
   EError error = EError::EOK;
-  UChar firstChar = 0;
+  // possible first symbols of the match, null if any symbol or empty match is possible
+  std::unique_ptr<CharacterClass> firstSet;
+  int minLength = 0;
+  // literal, which must be in any match, and its offset from the match start (-1 if not fixed)
+  UnicodeString requiredLiteral;
+  int literalOffset = -1;
   EMetaSymbols firstMetaChar = EMetaSymbols::ReBadMeta;
+  EReKind kind = EReKind::General;
+  // RE has the operators, which match surrogate pair as the single symbol
+  bool codePoints = false;
+  CRegExpNative native = nullptr;
 #ifdef COLORERMODE
-  CRegExp* backRE = nullptr;
+  const CRegExp* backRE = nullptr;
   const UnicodeString* backStr = nullptr;
   SMatches* backTrace = nullptr;
-  int schemeStart = 0;
+  // brackets of backRE, read by \y \Y operators, one bit per bracket
+  unsigned int backTraceBrackets = 0;
+  unsigned int backTraceNamed = 0;
 #endif
-  bool startChange = false;
-  bool endChange = false;
-  const UnicodeString* global_pattern = nullptr;
-  int end = 0;
 
-  SMatches* matches = nullptr;
   int cMatch = 0;
 #if !defined NAMED_MATCHES_IN_HASH
   UnicodeString* brnames[NAMED_MATCHES_NUM] = {};
@@ -349,26 +889,158 @@ class CRegExp
   void init();
   EError setRELow(const UnicodeString& re);
   EError setStructs(SRegInfo*&, const UnicodeString& expr, int& endPos);
+  int numberNodes(SRegInfo* re, int id);
+  void compileProgram(const SRegInfo* re);
+  void compileNfa();
+  int nfaAdd(ENfaOp op, int out, int out1 = -1);
+  int nfaChain(const SRegInfo* re, int cont);
+  int nfaNode(const SRegInfo* re, int cont);
+  int nfaRepeat(const SRegInfo* re, int cont);
 
+  static bool hasBackReferences(const SRegInfo* re);
+#ifdef COLORERMODE
+  void markBackTrace(const SRegInfo* re);
+#endif
+  static bool hasCaptures(const SRegInfo* re);
+  int markMemoRanges(SRegInfo* re, bool allowed, int slot, bool capturesAfter);
+  bool startMemo(MatchState& st) const;
+  int memoState(const MatchState& st, int slot, int toParse) const;
+  void memoMark(MatchState& st, int slot, int toParse, int state) const;
   void optimize();
-  bool quickCheck(int toParse);
-  bool isWordBoundary(int toParse);
-  bool isNWordBoundary(int toParse);
-  bool checkMetaSymbol(EMetaSymbols metaSymbol, int& toParse);
-  bool lowParse(SRegInfo* re, SRegInfo* prev, int toParse);
-  bool parseRE(int toParse);
-
-  int count_elem;
-  void check_stack(bool res, SRegInfo** re, SRegInfo** prev, int* toParse, bool* leftenter,
-                   int* action);
-  void insert_stack(SRegInfo** re, SRegInfo** prev, int* toParse, bool* leftenter, int ifTrueReturn,
-                    int ifFalseReturn, SRegInfo** re2, SRegInfo** prev2, int toParse2);
-
-  static StackElem* RegExpStack;
-  static int RegExpStack_Size;
+  bool firstSetChain(const SRegInfo* re, icu::UnicodeSet& set) const;
+  bool firstSetNode(const SRegInfo* re, icu::UnicodeSet& set) const;
+  int minLengthChain(const SRegInfo* re) const;
+  int minLengthNode(const SRegInfo* re) const;
+  static bool isRepeat(const SRegInfo* re);
+  bool endsWithRepeat(const SRegInfo* re, bool tail, const icu::UnicodeSet& follow) const;
+  bool fixedPrefix(const SRegInfo* re, std::vector<icu::UnicodeSet>& sets) const;
+  bool overlappingAlternatives(const SRegInfo* re) const;
+  void collectAmbiguities(const SRegInfo* re, std::vector<SReAmbiguity>& found) const;
+  static bool hasBranches(const SRegInfo* re);
+  static int fixedLength(const SRegInfo* re);
+  void extractLiteral(const SRegInfo* re, int offset);
+  int findLiteral(const MatchState& st, int from) const;
+  void classify();
+  bool directParse(MatchState& st, int toParse) const;
+  bool isFirstSymbol(UChar c) const;
+  bool firstCheck(const MatchState& st, int toParse) const;
+  bool quickCheck(const MatchState& st, int toParse) const;
+  bool isWordBoundary(const MatchState& st, int toParse) const;
+  bool isNWordBoundary(const MatchState& st, int toParse) const;
+  bool checkMetaSymbol(MatchState& st, EMetaSymbols metaSymbol, int& toParse) const;
+  static bool hasCodePointOps(const SRegInfo* re);
+  static UChar32 supplementaryAt(const MatchState& st, int pos);
+  static bool checkClass(const MatchState& st, const CharacterClass* cc, bool inverse,
+                         int& toParse);
+  bool lowParse(MatchState& st, SRegInfo* re, SRegInfo* prev, int toParse) const;
+  bool programParse(MatchState& st, int toParse) const;
+  bool dfaCheck(MatchState& st, int toParse, bool search) const;
+  int dfaState(RegExpContext* context, SDfaCache* cache, std::vector<int>& set, int flags) const;
+  int dfaStep(RegExpContext* context, SDfaCache* cache, int state, int c) const;
+  void nfaClosure(RegExpContext* context, std::vector<int>& set, int from) const;
+  void nfaResolve(RegExpContext* context, std::vector<int>& set, int flags, int c) const;
+  bool nativeParse(MatchState& st, int toParse) const;
+  bool nativeChain(std::string& code, const std::string& name, const SRegInfo* re) const;
+  bool nativeNode(std::string& code, const std::string& name, const SRegInfo* re) const;
+  bool nativeAtom(std::string& code, const std::string& name, const SRegInfo* re) const;
+  bool parseRE(MatchState& st, int toParse, EEngine eng) const;
+  bool run(MatchState& st, int toParse) const;
+  bool runEngines(MatchState& st, int toParse) const;
+
+  static void check_stack(RegExpContext* context, bool res, SRegInfo** re, SRegInfo** prev,
+                          int* toParse, bool* leftenter, int* action);
+  static void insert_stack(RegExpContext* context, SRegInfo** re, SRegInfo** prev, int* toParse,
+                           bool* leftenter, int ifTrueReturn, int ifFalseReturn, SRegInfo** re2,
+                           SRegInfo** prev2, int toParse2);
 
  public:
+  /**
+    Frees backtracking stack of the calling thread default context.
+  */
   static void clearRegExpStack();
 };
 
+/** State of the single CRegExp::parse call.
+    @ingroup cregexp
+*/
+struct CRegExp::MatchState
+{
+  const UnicodeString* global_pattern;
+  int end;
+  SMatches* matches;
+#ifdef NAMED_MATCHES_IN_HASH
+  SMatchHash* namedMatches;
+#endif
+#ifdef COLORERMODE
+  const UnicodeString* backStr;
+  const SMatches* backTrace;
+  int schemeStart;
+#endif
+  bool positionMoves;
+  bool startChange;
+  bool endChange;
+  // string may have surrogate pairs, which are matched as one symbol
+  bool surrogates;
+  RegExpContext* context;
+  SRegState* nodes;
+  // steps limit (0 - no limit) and count of the steps of all start positions
+  int stepLimit;
+  int steps;
+  bool stepLimitHit;
+  // range states memo, null until MEMO_MIN_FAILS failures
+  // (fields are packed, value initialization of the bigger struct is slower)
+  int memoFails;
+  uint64_t* memo;
+};
+
+/**
+  Returns MEMO_* bits of the range decision at the position.
+*/
+inline int CRegExp::memoState(const MatchState& st, int slot, int toParse) const
+{
+  if (!st.memo || toParse > st.end)
+    return 0;
+  size_t bit = (static_cast<size_t>(slot) * (st.end + 1) + toParse) * 2;
+  return (st.memo[bit >> 6] >> (bit & 63)) & 3;
+}
+
+/**
+  Returns code point of the surrogate pair at the position,
+  or 0 if there is no pair or the pairs are not checked.
+*/
+inline UChar32 CRegExp::supplementaryAt(const MatchState& st, int pos)
+{
+  UChar c = (*st.global_pattern)[pos];
+  // lead surrogate is checked first, BMP symbols don't touch the state
+  if (!U16_IS_LEAD(c) || !st.surrogates || pos + 1 >= st.end)
+    return 0;
+  UChar c2 = (*st.global_pattern)[pos + 1];
+  if (!U16_IS_TRAIL(c2))
+    return 0;
+  return U16_GET_SUPPLEMENTARY(c, c2);
+}
+
+/**
+  Matches the symbol of the character class (or out of it, if @c inverse) at the position.
+*/
+inline bool CRegExp::checkClass(const MatchState& st, const CharacterClass* cc, bool inverse,
+                                int& toParse)
+{
+  if (toParse >= st.end)
+    return false;
+  UChar c = (*st.global_pattern)[toParse];
+  if (U16_IS_LEAD(c)) {
+    if (UChar32 sc = supplementaryAt(st, toParse)) {
+      if (cc->containsSupplementary(sc) == inverse)
+        return false;
+      toParse += 2;
+      return true;
+    }
+  }
+  if (cc->contains(c) == inverse)
+    return false;
+  toParse++;
+  return true;
+}
+
 #endif  // COLORER_CREGEXP_H
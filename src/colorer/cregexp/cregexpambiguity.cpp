@@ -0,0 +1,189 @@
+#include "colorer/cregexp/cregexp.h"
+#include "colorer/common/UStr.h"
+
+////////////////////////////////////////////////////////////////////////////
+// ambiguous repeats analysis
+//
+// Repeat is ambiguous, if the same text can be split between its iterations
+// in several ways. Failing match tries all of them, so the time grows
+// exponentially with the text length, unless the repeat has the range states memo.
+// Checks are structural and conservative: repeat is reported, if the ambiguity
+// is possible by the symbol sets, without exact comparison of the languages.
+
+// bounded repeats with more iterations are reported as exponential
+#define AMBIGUITY_MAX_BOUNDED 8
+
+/**
+  Checks, if the range makes more than one iteration and their count is not fixed.
+*/
+bool CRegExp::isRepeat(const SRegInfo* re)
+{
+  switch (re->op) {
+    case EOps::ReRangeN:
+    case EOps::ReNGRangeN:
+      return true;
+    case EOps::ReRangeNM:
+    case EOps::ReNGRangeNM:
+      return re->e > 1 && re->e > re->s;
+    default:
+      return false;
+  }
+}
+
+/**
+  Checks, if the chain can end with the repeat, which can take the first symbol of @c follow.
+  @param tail Text after the chain can be empty.
+*/
+bool CRegExp::endsWithRepeat(const SRegInfo* re, bool tail, const icu::UnicodeSet& follow) const
+{
+  icu::UnicodeSet scratch;
+  for (; re; re = re->next) {
+    if (re->op == EOps::ReOr)
+      return endsWithRepeat(re->un.param, tail, follow) || endsWithRepeat(re->next, tail, follow);
+    // all nodes after this one can match empty string
+    if (!tail || !firstSetChain(re->next, scratch))
+      continue;
+    if (isRepeat(re)) {
+      icu::UnicodeSet first;
+      firstSetChain(re->un.param, first);
+      if (first.containsSome(follow))
+        return true;
+    }
+    if ((re->op == EOps::ReBrackets || re->op == EOps::ReNamedBrackets) &&
+        endsWithRepeat(re->un.param, true, follow))
+      return true;
+  }
+  return false;
+}
+
+/**
+  Collects the symbol sets of the fixed start of the chain, one set per matched symbol.
+  Set of the first symbols of not fixed part is added, if it can't be empty.
+  @return true, if the whole chain is fixed.
+*/
+bool CRegExp::fixedPrefix(const SRegInfo* re, std::vector<icu::UnicodeSet>& sets) const
+{
+  for (; re; re = re->next) {
+    switch (re->op) {
+      case EOps::ReEmpty:
+      case EOps::ReAhead:
+      case EOps::ReNAhead:
+      case EOps::ReBehind:
+      case EOps::ReNBehind:
+        break;
+      case EOps::ReSymb:
+      case EOps::ReEnum:
+      case EOps::ReNEnum:
+      case EOps::ReMetaSymb: {
+        // assertions match empty string
+        icu::UnicodeSet set;
+        if (!firstSetNode(re, set))
+          sets.push_back(set);
+        break;
+      }
+      case EOps::ReWord:
+        for (int i = 0; i < re->un.word->length(); i++) {
+          UChar c = (*re->un.word)[i];
+          icu::UnicodeSet set(c, c);
+          if (ignoreCase) {
+            set.closeOver(USET_CASE_INSENSITIVE);
+            set.add(UStr::toLowerCase(c));
+            set.add(UStr::toUpperCase(c));
+          }
+          sets.push_back(set);
+        }
+        break;
+      case EOps::ReBrackets:
+      case EOps::ReNamedBrackets:
+        if (!fixedPrefix(re->un.param, sets))
+          return false;
+        break;
+      default: {
+        // alternatives, ranges and backreferences
+        icu::UnicodeSet set;
+        bool empty = re->op == EOps::ReOr ? firstSetChain(re, set) : firstSetNode(re, set);
+        if (!empty)
+          sets.push_back(set);
+        return false;
+      }
+    }
+  }
+  return true;
+}
+
+/**
+  Checks, if the alternatives of the repeated chain can match the same text
+  or can split the text of the other alternative into iterations.
+*/
+bool CRegExp::overlappingAlternatives(const SRegInfo* re) const
+{
+  while (re && !re->next && (re->op == EOps::ReBrackets || re->op == EOps::ReNamedBrackets))
+    re = re->un.param;
+  if (!re || re->op != EOps::ReOr)
+    return false;
+
+  icu::UnicodeSet follow;
+  firstSetChain(re, follow);
+  std::vector<std::vector<icu::UnicodeSet>> prefixes;
+  std::vector<bool> fixed;
+  for (; re; re = re->next) {
+    prefixes.emplace_back();
+    if (re->op != EOps::ReOr) {
+      fixed.push_back(fixedPrefix(re, prefixes.back()));
+      break;
+    }
+    fixed.push_back(fixedPrefix(re->un.param, prefixes.back()));
+  }
+
+  for (size_t a = 0; a < prefixes.size(); a++) {
+    for (size_t b = a + 1; b < prefixes.size(); b++) {
+      size_t shorter = prefixes[a].size() <= prefixes[b].size() ? a : b;
+      size_t longer = shorter == a ? b : a;
+      size_t len = prefixes[shorter].size();
+      bool same = true;
+      for (size_t i = 0; i < len && same; i++)
+        same = prefixes[a][i].containsSome(prefixes[b][i]);
+      // empty alternative doesn't make the iterations
+      if (!same || (fixed[shorter] && len == 0))
+        continue;
+      // texts of the different length: the rest of the longer one can be the next iteration
+      if (!fixed[shorter] || prefixes[longer].size() == len ||
+          prefixes[longer][len].containsSome(follow))
+        return true;
+    }
+  }
+  return false;
+}
+
+void CRegExp::collectAmbiguities(const SRegInfo* re, std::vector<SReAmbiguity>& found) const
+{
+  for (; re; re = re->next) {
+    if (isRepeat(re)) {
+      icu::UnicodeSet follow;
+      firstSetChain(re->un.param, follow);
+      bool nested = endsWithRepeat(re->un.param, true, follow);
+      if (nested || overlappingAlternatives(re->un.param)) {
+        SReAmbiguity ambiguity;
+        ambiguity.kind = nested ? EReAmbiguity::NestedRepeat : EReAmbiguity::OverlappingOr;
+        ambiguity.s = re->s;
+        ambiguity.e = re->op == EOps::ReRangeN || re->op == EOps::ReNGRangeN ? -1 : re->e;
+        // count of the ways to split the text is polynomial for the few iterations
+        ambiguity.exponential =
+            re->param0 == -1 && (ambiguity.e == -1 || ambiguity.e > AMBIGUITY_MAX_BOUNDED);
+        found.push_back(ambiguity);
+      }
+    }
+    if (re->op > EOps::ReBlockOps &&
+        (re->op < EOps::ReSymbolOps || re->op == EOps::ReBrackets ||
+         re->op == EOps::ReNamedBrackets))
+      collectAmbiguities(re->un.param, found);
+  }
+}
+
+std::vector<SReAmbiguity> CRegExp::findAmbiguities() const
+{
+  std::vector<SReAmbiguity> found;
+  if (error == EError::EOK)
+    collectAmbiguities(tree_root, found);
+  return found;
+}
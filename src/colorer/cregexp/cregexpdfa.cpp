@@ -0,0 +1,472 @@
+#include <algorithm>
+#include <atomic>
+#include <climits>
+#include "colorer/cregexp/cregexp.h"
+#include "colorer/common/UStr.h"
+
+#ifndef NAMED_MATCHES_IN_HASH
+
+// maximum count of NFA states, RE with bigger NFA is matched without DFA prefilter
+#define NFA_MAX_STATES 2048
+
+// flags of the symbol before current position
+#define DFA_AT_START 1
+#define DFA_PREV_WORD 2
+#define DFA_PREV_LETTER 4
+#define DFA_PREV_NEWLINE 8
+
+// end of line instead of symbol
+#define DFA_EOL (-1)
+
+static int symbolFlags(UChar c)
+{
+  int flags = 0;
+  if (UStr::isWordSymbol(c))
+    flags |= DFA_PREV_WORD;
+  if (UStr::isLetter(c))
+    flags |= DFA_PREV_LETTER;
+  if (UStr::isLineBreak(c))
+    flags |= DFA_PREV_NEWLINE;
+  return flags;
+}
+
+/**
+  Checks, if the RE can be represented with NFA.
+*/
+static bool isNfaSuitable(const SRegInfo* re)
+{
+  for (; re; re = re->next) {
+    switch (re->op) {
+      case EOps::ReAhead:
+      case EOps::ReNAhead:
+      case EOps::ReBehind:
+      case EOps::ReNBehind:
+      case EOps::ReBkBrack:
+      case EOps::ReBkBrackName:
+#ifdef COLORERMODE
+      case EOps::ReBkTrace:
+      case EOps::ReBkTraceN:
+      case EOps::ReBkTraceName:
+      case EOps::ReBkTraceNName:
+#endif
+        return false;
+      default:
+        break;
+    }
+    if (re->op > EOps::ReBlockOps &&
+        (re->op < EOps::ReSymbolOps || re->op == EOps::ReBrackets ||
+         re->op == EOps::ReNamedBrackets) &&
+        !isNfaSuitable(re->un.param))
+      return false;
+  }
+  return true;
+}
+
+SDfaCache::SDfaCache()
+{
+  auto dead = std::make_unique<SDfaState>();
+  dead->flags = 0;
+  dead->dead = true;
+  dead->acceptEnd = 0;
+  std::fill(std::begin(dead->next), std::end(dead->next), 0);
+  states.push_back(std::move(dead));
+  for (auto& search_start : start) std::fill(std::begin(search_start), std::end(search_start), -1);
+  for (auto& rc : recent) rc.state = -1;
+}
+
+////////////////////////////////////////////////////////////////////////////
+// NFA compiler
+//
+// NFA is built for the existence check only, so the greedy and non greedy
+// operators are the same. Backtracker doesn't restore the counters of
+// the ranges, when it returns into the previous iteration, so the range
+// with the backtracking points inside is built without lower bound:
+// NFA must accept all lines, accepted by backtracker.
+
+void CRegExp::compileNfa()
+{
+  static std::atomic<unsigned int> dfa_counter {0};
+
+  nfa.clear();
+  nfaStart = nfaSearch = -1;
+  nfaAsserts = false;
+  if (!isNfaSuitable(tree_root))
+    return;
+
+  int match = nfaAdd(ENfaOp::NfaMatch, -1);
+  int start = nfaNode(tree_root, match);
+  if (nfa.size() > NFA_MAX_STATES) {
+    nfa.clear();
+    nfa.shrink_to_fit();
+    return;
+  }
+  nfaStart = start;
+  // search from any position: (.*)RE
+  int any = nfaAdd(ENfaOp::NfaAny, -1);
+  nfaSearch = nfaAdd(ENfaOp::NfaSplit, any, nfaStart);
+  nfa[any].out = nfaSearch;
+  dfaId = ++dfa_counter;
+}
+
+int CRegExp::nfaAdd(ENfaOp op, int out, int out1)
+{
+  SNfaState ns {};
+  ns.op = op;
+  ns.metaSymbol = EMetaSymbols::ReBadMeta;
+  ns.out = out;
+  ns.out1 = out1;
+  nfa.push_back(ns);
+  return static_cast<int>(nfa.size()) - 1;
+}
+
+int CRegExp::nfaChain(const SRegInfo* re, int cont)
+{
+  std::vector<const SRegInfo*> chain;
+  for (; re; re = re->next) chain.push_back(re);
+  int cur = cont;
+  for (auto it = chain.rbegin(); it != chain.rend(); ++it) {
+    if (nfa.size() > NFA_MAX_STATES)
+      break;
+    if ((*it)->op == EOps::ReOr) {
+      // left alternative leaves the chain, right one is the rest of the chain
+      cur = nfaAdd(ENfaOp::NfaSplit, nfaChain((*it)->un.param, cont), cur);
+    }
+    else
+      cur = nfaNode(*it, cur);
+  }
+  return cur;
+}
+
+int CRegExp::nfaNode(const SRegInfo* re, int cont)
+{
+  int cur;
+  switch (re->op) {
+    case EOps::ReBrackets:
+    case EOps::ReNamedBrackets:
+      return nfaChain(re->un.param, cont);
+    case EOps::ReSymb:
+      if (ignoreCase) {
+        cur = nfaAdd(ENfaOp::NfaSymbNoCase, cont);
+        nfa[cur].ch = UStr::toLowerCase(re->un.symbol);
+        nfa[cur].ch2 = UStr::toUpperCase(re->un.symbol);
+      }
+      else {
+        cur = nfaAdd(ENfaOp::NfaSymb, cont);
+        nfa[cur].ch = re->un.symbol;
+      }
+      return cur;
+    case EOps::ReWord: {
+      const UnicodeString& word = *re->un.word;
+      // case insensitive word is compared with full case folding,
+      // per symbol check is exact only if the word is stored folded
+      bool fold_single = re->param0 != 0;
+      cur = cont;
+      for (int i = word.length() - 1; i >= 0; i--) {
+        if (!ignoreCase) {
+          cur = nfaAdd(ENfaOp::NfaSymb, cur);
+          nfa[cur].ch = word[i];
+        }
+        else if (fold_single) {
+          cur = nfaAdd(ENfaOp::NfaSymbFold, cur);
+          nfa[cur].ch = word[i];
+        }
+        else
+          cur = nfaAdd(ENfaOp::NfaAny, cur);
+      }
+      return cur;
+    }
+    case EOps::ReMetaSymb:
+      switch (re->un.metaSymbol) {
+        case EMetaSymbols::ReAnyChr:
+          if (singleLine)
+            return nfaAdd(ENfaOp::NfaAny, cont);
+          [[fallthrough]];
+        case EMetaSymbols::ReDigit:
+        case EMetaSymbols::ReNDigit:
+        case EMetaSymbols::ReWordSymb:
+        case EMetaSymbols::ReNWordSymb:
+        case EMetaSymbols::ReWSpace:
+        case EMetaSymbols::ReNWSpace:
+        case EMetaSymbols::ReUCase:
+        case EMetaSymbols::ReNUCase:
+          cur = nfaAdd(ENfaOp::NfaMetaSymb, cont);
+          nfa[cur].metaSymbol = re->un.metaSymbol;
+          return cur;
+        case EMetaSymbols::ReSoL:
+        case EMetaSymbols::ReEoL:
+        case EMetaSymbols::ReWBound:
+        case EMetaSymbols::ReNWBound:
+        case EMetaSymbols::RePreNW:
+          nfaAsserts = true;
+          cur = nfaAdd(ENfaOp::NfaAssert, cont);
+          nfa[cur].metaSymbol = re->un.metaSymbol;
+          return cur;
+        default:
+          // \m \M and ~ (scheme start is unknown to DFA) are always true
+          return cont;
+      }
+    case EOps::ReEnum:
+    case EOps::ReNEnum:
+      cur = nfaAdd(re->op == EOps::ReEnum ? ENfaOp::NfaEnum : ENfaOp::NfaNEnum, cont);
+      nfa[cur].charclass = re->un.charclass;
+      return cur;
+    case EOps::ReOr:
+      return nfaAdd(ENfaOp::NfaSplit, nfaChain(re->un.param, cont), cont);
+    case EOps::ReRangeN:
+    case EOps::ReRangeNM:
+    case EOps::ReNGRangeN:
+    case EOps::ReNGRangeNM:
+      return nfaRepeat(re, cont);
+    default:
+      return cont;
+  }
+}
+
+int CRegExp::nfaRepeat(const SRegInfo* re, int cont)
+{
+  const SRegInfo* body = re->un.param;
+  bool unbounded = re->op == EOps::ReRangeN || re->op == EOps::ReNGRangeN;
+  int low = hasBranches(body) ? 0 : re->s;
+  int cur;
+  if (unbounded) {
+    cur = nfaAdd(ENfaOp::NfaSplit, -1, cont);
+    int loop = nfaNode(body, cur);
+    nfa[cur].out = loop;
+  }
+  else {
+    cur = cont;
+    for (int i = low; i < re->e && nfa.size() <= NFA_MAX_STATES; i++)
+      cur = nfaAdd(ENfaOp::NfaSplit, nfaNode(body, cur), cont);
+  }
+  for (int i = 0; i < low && nfa.size() <= NFA_MAX_STATES; i++) cur = nfaNode(body, cur);
+  return cur;
+}
+
+////////////////////////////////////////////////////////////////////////////
+// lazy DFA
+
+void CRegExp::nfaClosure(RegExpContext* context, std::vector<int>& set, int from) const
+{
+  int* marks = context->nfa_marks.data();
+  int mark = context->nfa_mark;
+  while (from != -1 && marks[from] != mark) {
+    marks[from] = mark;
+    const SNfaState& ns = nfa[from];
+    if (ns.op != ENfaOp::NfaSplit) {
+      set.push_back(from);
+      return;
+    }
+    nfaClosure(context, set, ns.out);
+    from = ns.out1;
+  }
+}
+
+void CRegExp::nfaResolve(RegExpContext* context, std::vector<int>& set, int flags, int c) const
+{
+  bool at_start = flags & DFA_AT_START;
+  for (size_t i = 0; i < set.size(); i++) {
+    const SNfaState& ns = nfa[set[i]];
+    if (ns.op != ENfaOp::NfaAssert)
+      continue;
+    bool ok = false;
+    switch (ns.metaSymbol) {
+      case EMetaSymbols::ReSoL:
+        ok = at_start || (multiLine && (flags & DFA_PREV_NEWLINE));
+        break;
+      case EMetaSymbols::ReEoL:
+        ok = c == DFA_EOL || (multiLine && !at_start && (flags & DFA_PREV_NEWLINE));
+        break;
+      case EMetaSymbols::ReWBound:
+      case EMetaSymbols::ReNWBound:
+        ok = ((flags & DFA_PREV_WORD) != 0) != (c != DFA_EOL && UStr::isWordSymbol(c));
+        if (ns.metaSymbol == EMetaSymbols::ReNWBound)
+          ok = !ok;
+        break;
+      case EMetaSymbols::RePreNW:
+        ok = c == DFA_EOL || at_start || !(flags & DFA_PREV_LETTER);
+        break;
+      default:
+        break;
+    }
+    if (ok)
+      nfaClosure(context, set, ns.out);
+  }
+}
+
+static bool nfaMatchSymbol(const SNfaState& ns, UChar c)
+{
+  switch (ns.op) {
+    case ENfaOp::NfaSymb:
+      return c == ns.ch;
+    case ENfaOp::NfaSymbNoCase:
+      return UStr::toLowerCase(c) == ns.ch || UStr::toUpperCase(c) == ns.ch2;
+    case ENfaOp::NfaSymbFold:
+      return UStr::foldCase(c) == ns.ch;
+    case ENfaOp::NfaEnum:
+      return ns.charclass->contains(c);
+    case ENfaOp::NfaNEnum:
+      return !ns.charclass->contains(c);
+    case ENfaOp::NfaAny:
+      return true;
+    case ENfaOp::NfaMetaSymb:
+      switch (ns.metaSymbol) {
+        case EMetaSymbols::ReAnyChr:
+          return !UStr::isLineBreak(c);
+        case EMetaSymbols::ReDigit:
+          return UStr::isDigit(c);
+        case EMetaSymbols::ReNDigit:
+          return !UStr::isDigit(c);
+        case EMetaSymbols::ReWordSymb:
+          return UStr::isWordSymbol(c);
+        case EMetaSymbols::ReNWordSymb:
+          return !UStr::isWordSymbol(c);
+        case EMetaSymbols::ReWSpace:
+          return UStr::isWhitespace(c);
+        case EMetaSymbols::ReNWSpace:
+          return !UStr::isWhitespace(c);
+        case EMetaSymbols::ReUCase:
+          return UStr::isUpperCase(c);
+        case EMetaSymbols::ReNUCase:
+          return UStr::isLowerCase(c);
+        default:
+          return false;
+      }
+    default:
+      return false;
+  }
+}
+
+int CRegExp::dfaState(RegExpContext* context, SDfaCache* cache, std::vector<int>& set,
+                      int flags) const
+{
+  if (set.empty())
+    return 0;
+  std::sort(set.begin(), set.end());
+  if (!nfaAsserts)
+    flags = 0;
+  auto key = std::make_pair(flags, set);
+  auto it = cache->index.find(key);
+  if (it != cache->index.end())
+    return it->second;
+  if (cache->states.size() >= DFA_MAX_STATES || context->dfa_states >= DFA_MAX_TOTAL_STATES)
+    return -1;
+
+  auto state = std::make_unique<SDfaState>();
+  state->nfa = set;
+  state->flags = flags;
+  state->dead = false;
+  state->acceptEnd = -1;
+  std::fill(std::begin(state->next), std::end(state->next), -1);
+  int idx = static_cast<int>(cache->states.size());
+  cache->states.push_back(std::move(state));
+  cache->index.emplace(std::move(key), idx);
+  context->dfa_states++;
+  return idx;
+}
+
+int CRegExp::dfaStep(RegExpContext* context, SDfaCache* cache, int state, int c) const
+{
+  const SDfaState& ds = *cache->states[state];
+  std::vector<int> cur(ds.nfa);
+  context->nfa_mark++;
+  for (int ns : cur) context->nfa_marks[ns] = context->nfa_mark;
+  nfaResolve(context, cur, ds.flags, c);
+
+  bool accept = false;
+  for (int ns : cur) accept = accept || nfa[ns].op == ENfaOp::NfaMatch;
+  if (c == DFA_EOL)
+    return accept;
+
+  std::vector<int> next;
+  context->nfa_mark++;
+  for (int ns : cur)
+    if (nfaMatchSymbol(nfa[ns], static_cast<UChar>(c)))
+      nfaClosure(context, next, nfa[ns].out);
+  int next_state = dfaState(context, cache, next, symbolFlags(static_cast<UChar>(c)));
+  if (next_state < 0)
+    return -1;
+  return (next_state << 1) | (accept ? 1 : 0);
+}
+
+/**
+  Checks, if the match of RE is possible at position @c toParse (or after it, if @c search).
+  False result is exact, true - means, that backtracker must be run.
+*/
+bool CRegExp::dfaCheck(MatchState& st, int toParse, bool search) const
+{
+  RegExpContext* context = st.context;
+  auto& slot = context->dfa[dfaId];
+  if (!slot)
+    slot = std::make_unique<SDfaCache>();
+  SDfaCache* cache = slot.get();
+  if (context->nfa_marks.size() < nfa.size())
+    context->nfa_marks.resize(nfa.size(), 0);
+  if (context->nfa_mark > INT_MAX - 4 * static_cast<int>(nfa.size()) - 16) {
+    std::fill(context->nfa_marks.begin(), context->nfa_marks.end(), 0);
+    context->nfa_mark = 0;
+  }
+
+  const UChar* pattern = st.global_pattern->getBuffer();
+  int flags = 0;
+  if (nfaAsserts)
+    flags = toParse == 0 ? DFA_AT_START : symbolFlags(pattern[toParse - 1]);
+
+  int state = cache->start[search][flags];
+  if (state == -1) {
+    std::vector<int> set;
+    context->nfa_mark++;
+    nfaClosure(context, set, search ? nfaSearch : nfaStart);
+    state = dfaState(context, cache, set, flags);
+    if (state < 0) {
+      context->dfaFlush(dfaId);
+      return true;
+    }
+    cache->start[search][flags] = state;
+  }
+
+  for (int i = toParse; i < st.end; i++) {
+    UChar c = pattern[i];
+    int trans;
+    if (c < DFA_DIRECT_SIZE) {
+      trans = cache->states[state]->next[c];
+      if (trans < 0) {
+        trans = dfaStep(context, cache, state, c);
+        if (trans < 0) {
+          context->dfaFlush(dfaId);
+          return true;
+        }
+        cache->states[state]->next[c] = trans;
+      }
+    }
+    else {
+      // DFA works with code units, the rest can have surrogate pairs as one symbol
+      if (st.surrogates && U16_IS_SURROGATE(c))
+        return true;
+      auto& rc = cache->recent[(state * 31 + c) & (DFA_RECENT_SIZE - 1)];
+      if (rc.state == state && rc.c == c)
+        trans = rc.result;
+      else {
+        trans = dfaStep(context, cache, state, c);
+        if (trans < 0) {
+          context->dfaFlush(dfaId);
+          return true;
+        }
+        rc.state = state;
+        rc.c = c;
+        rc.result = trans;
+      }
+    }
+    // match ends before the symbol
+    if (trans & 1)
+      return true;
+    state = trans >> 1;
+    if (state == 0)
+      return false;
+  }
+  SDfaState& ds = *cache->states[state];
+  if (ds.acceptEnd == -1)
+    ds.acceptEnd = static_cast<signed char>(dfaStep(context, cache, state, DFA_EOL));
+  return ds.acceptEnd != 0;
+}
+
+#endif  // NAMED_MATCHES_IN_HASH
@@ -0,0 +1,333 @@
+#include <cstdio>
+#include "colorer/cregexp/cregexp.h"
+#include "colorer/common/UStr.h"
+
+#ifndef NAMED_MATCHES_IN_HASH
+
+/*
+  Generated matcher is the set of functions in the continuation passing style.
+  Function of the tree node matches the node and the rest of its chain, then calls
+  continuation k with the end position. Backtracking is the return of false to the
+  caller, which tries its next variant. Functions are written after the functions
+  they call, so the chain is generated from its end.
+*/
+
+static std::string hex(int value)
+{
+  char buf[16];
+  snprintf(buf, sizeof(buf), "0x%X", value);
+  return buf;
+}
+
+static std::string nodeName(const std::string& name, const SRegInfo* re)
+{
+  return name + "_n" + std::to_string(re->id);
+}
+
+static std::string atomName(const std::string& name, const SRegInfo* re)
+{
+  return name + "_a" + std::to_string(re->id);
+}
+
+/**
+  Call of the rest of the chain after the node.
+*/
+static std::string nextCall(const std::string& name, const SRegInfo* re, const std::string& pos)
+{
+  if (re->next)
+    return nodeName(name, re->next) + "(m, " + pos + ", k)";
+  return "k(" + pos + ")";
+}
+
+/**
+  Atom, which may match surrogate pair as the single symbol.
+*/
+static bool isCodePointAtom(const SRegInfo* re)
+{
+  if (re->op == EOps::ReEnum || re->op == EOps::ReNEnum)
+    return true;
+  return re->op == EOps::ReMetaSymb &&
+         (re->un.metaSymbol == EMetaSymbols::ReAnyChr || re->un.metaSymbol == EMetaSymbols::ReWordSymb ||
+          re->un.metaSymbol == EMetaSymbols::ReNWordSymb);
+}
+
+/**
+  Generates function, which returns the end of the single symbol node at the position, or -1.
+*/
+bool CRegExp::nativeAtom(std::string& code, const std::string& name, const SRegInfo* re) const
+{
+  std::string fn = atomName(name, re);
+  std::string body;
+  switch (re->op) {
+    case EOps::ReSymb:
+      if (ignoreCase) {
+        body = "  if (p >= m.end)\n    return -1;\n  UChar c = m.text[p];\n  return UStr::toLowerCase(c) == " +
+               hex(UStr::toLowerCase(re->un.symbol)) + " || UStr::toUpperCase(c) == " +
+               hex(UStr::toUpperCase(re->un.symbol)) + " ? p + 1 : -1;\n";
+      }
+      else
+        body = "  return p < m.end && m.text[p] == " + hex(re->un.symbol) + " ? p + 1 : -1;\n";
+      break;
+    case EOps::ReEnum:
+    case EOps::ReNEnum: {
+      const icu::UnicodeSet& set = re->un.charclass->getSet();
+      code += "static const CharacterClass " + fn + "_class = [] {\n  icu::UnicodeSet set;\n";
+      for (int i = 0; i < set.getRangeCount(); i++)
+        code += "  set.add(" + hex(set.getRangeStart(i)) + ", " + hex(set.getRangeEnd(i)) + ");\n";
+      code += "  return CharacterClass(set);\n}();\n\n";
+      body = "  return m.checkClass(" + fn + "_class, " +
+             (re->op == EOps::ReNEnum ? "true" : "false") + ", p);\n";
+      break;
+    }
+    case EOps::ReMetaSymb:
+      switch (re->un.metaSymbol) {
+        case EMetaSymbols::ReAnyChr:
+          body = "  if (p >= m.end";
+          if (!singleLine)
+            body += " || UStr::isLineBreak(m.text[p])";
+          body += ")\n    return -1;\n  return m.supplementaryAt(p) ? p + 2 : p + 1;\n";
+          break;
+        case EMetaSymbols::ReDigit:
+          body = "  return p < m.end && UStr::isDigit(m.text[p]) ? p + 1 : -1;\n";
+          break;
+        case EMetaSymbols::ReNDigit:
+          body = "  return p < m.end && !UStr::isDigit(m.text[p]) ? p + 1 : -1;\n";
+          break;
+        case EMetaSymbols::ReWordSymb:
+        case EMetaSymbols::ReNWordSymb: {
+          std::string no = re->un.metaSymbol == EMetaSymbols::ReWordSymb ? "!" : "";
+          body = "  if (p >= m.end)\n    return -1;\n  if (UChar32 sc = m.supplementaryAt(p))\n    return " +
+                 no + "UStr::isWordCodePoint(sc) ? -1 : p + 2;\n  return " + no +
+                 "UStr::isWordSymbol(m.text[p]) ? -1 : p + 1;\n";
+          break;
+        }
+        case EMetaSymbols::ReWSpace:
+          body = "  return p < m.end && UStr::isWhitespace(m.text[p]) ? p + 1 : -1;\n";
+          break;
+        case EMetaSymbols::ReNWSpace:
+          body = "  return p < m.end && !UStr::isWhitespace(m.text[p]) ? p + 1 : -1;\n";
+          break;
+        case EMetaSymbols::ReUCase:
+          body = "  return p < m.end && UStr::isUpperCase(m.text[p]) ? p + 1 : -1;\n";
+          break;
+        case EMetaSymbols::ReNUCase:
+          body = "  return p < m.end && UStr::isLowerCase(m.text[p]) ? p + 1 : -1;\n";
+          break;
+        default:
+          return false;
+      }
+      break;
+    default:
+      return false;
+  }
+  code += "static inline int " + fn + "(const SNativeMatch& m, int p)\n{\n" + body + "}\n\n";
+  return true;
+}
+
+/**
+  Condition of the zero width metasymbol at the position @c p.
+*/
+static std::string assertion(EMetaSymbols meta, bool multiLine)
+{
+  switch (meta) {
+    case EMetaSymbols::ReSoL:
+      return multiLine ? "p == 0 || UStr::isLineBreak(m.text[p - 1])" : "p == 0";
+    case EMetaSymbols::ReEoL:
+      return multiLine ? "p == m.end || (p && p < m.end && UStr::isLineBreak(m.text[p - 1]))"
+                       : "p == m.end";
+    case EMetaSymbols::ReWBound:
+      return "(p < m.end && UStr::isWordSymbol(m.text[p])) != (p > 0 && UStr::isWordSymbol(m.text[p - 1]))";
+    case EMetaSymbols::ReNWBound:
+      return "(p < m.end && UStr::isWordSymbol(m.text[p])) == (p > 0 && UStr::isWordSymbol(m.text[p - 1]))";
+    case EMetaSymbols::RePreNW:
+      return "p >= m.end || p == 0 || !UStr::isLetter(m.text[p - 1])";
+    case EMetaSymbols::ReSoScheme:
+      return "p == m.schemeStart";
+    default:
+      return std::string();
+  }
+}
+
+bool CRegExp::nativeChain(std::string& code, const std::string& name, const SRegInfo* re) const
+{
+  if (!re)
+    return false;
+  if (re->next && !nativeChain(code, name, re->next))
+    return false;
+  return nativeNode(code, name, re);
+}
+
+bool CRegExp::nativeNode(std::string& code, const std::string& name, const SRegInfo* re) const
+{
+  const SRegInfo* param = re->un.param;
+  std::string next = nextCall(name, re, "p");
+  std::string body;
+  switch (re->op) {
+    case EOps::ReEmpty:
+      body = "  return " + next + ";\n";
+      break;
+    case EOps::ReSymb:
+    case EOps::ReEnum:
+    case EOps::ReNEnum:
+      if (!nativeAtom(code, name, re))
+        return false;
+      body = "  p = " + atomName(name, re) + "(m, p);\n  if (p < 0)\n    return false;\n  return " + next + ";\n";
+      break;
+    case EOps::ReMetaSymb: {
+      std::string cond = assertion(re->un.metaSymbol, multiLine);
+      if (re->un.metaSymbol == EMetaSymbols::ReStart || re->un.metaSymbol == EMetaSymbols::ReEnd) {
+        // the change is not undone on backtracking, as in the engines
+        body = re->un.metaSymbol == EMetaSymbols::ReStart ? "  m.matches->s[0] = p;\n  m.startChange = true;\n"
+                                                            : "  m.matches->e[0] = p;\n  m.endChange = true;\n";
+        body += "  return " + next + ";\n";
+        break;
+      }
+      if (!cond.empty()) {
+        body = "  if (!(" + cond + "))\n    return false;\n  return " + next + ";\n";
+        break;
+      }
+      if (!nativeAtom(code, name, re))
+        return false;
+      body = "  p = " + atomName(name, re) + "(m, p);\n  if (p < 0)\n    return false;\n  return " + next + ";\n";
+      break;
+    }
+    case EOps::ReWord: {
+      const UnicodeString& word = *re->un.word;
+      std::string len = std::to_string(word.length());
+      std::string wn = atomName(name, re) + "_word";
+      code += "static const UChar " + wn + "[] = {";
+      for (int i = 0; i < word.length(); i++) code += (i ? ", " : "") + hex(word[i]);
+      code += "};\n\n";
+      body = "  if (p + " + len + " > m.end)\n    return false;\n";
+      if (ignoreCase && re->param0)
+        body += "  for (int i = 0; i < " + len + "; i++)\n    if (UStr::foldCase(m.text[p + i]) != " + wn +
+                "[i])\n      return false;\n";
+      else if (ignoreCase)
+        body += "  if (icu::UnicodeString(false, m.text + p, " + len + ").caseCompare(0, " + len + ", " + wn +
+                ", 0, " + len + ", 0) != 0)\n    return false;\n";
+      else
+        body += "  if (u_memcmp(m.text + p, " + wn + ", " + len + ") != 0)\n    return false;\n";
+      body += "  return " + nextCall(name, re, "p + " + len) + ";\n";
+      break;
+    }
+    case EOps::ReBrackets:
+    case EOps::ReNamedBrackets: {
+      if (!nativeChain(code, name, param))
+        return false;
+      if (re->param0 == -1) {
+        body = "  return " + nodeName(name, param) + "(m, p, [&](int q) { return " + nextCall(name, re, "q") +
+               "; });\n";
+        break;
+      }
+      std::string br = std::to_string(re->param0);
+      if (re->op == EOps::ReBrackets && re->param0 == 0) {
+        body = "  int start = p;\n  return " + nodeName(name, param) +
+               "(m, p, [&](int q) {\n    SMatches* mt = m.matches;\n    if (!m.startChange)\n      mt->s[0] = start;\n"
+               "    if (!m.endChange)\n      mt->e[0] = q;\n    if (mt->e[0] < mt->s[0])\n      mt->s[0] = mt->e[0];\n"
+               "    return " + nextCall(name, re, "q") + ";\n  });\n";
+        break;
+      }
+      std::string ns = re->op == EOps::ReBrackets ? "" : "n";
+      body = "  int start = p;\n  return " + nodeName(name, param) + "(m, p, [&](int q) {\n    m.matches->" +
+             ns + "s[" + br + "] = start;\n    m.matches->" + ns + "e[" + br + "] = q;\n    return " +
+             nextCall(name, re, "q") + ";\n  });\n";
+      break;
+    }
+    case EOps::ReOr:
+      if (!nativeChain(code, name, param))
+        return false;
+      body = "  if (" + nodeName(name, param) + "(m, p, k))\n    return true;\n  return " + next + ";\n";
+      break;
+    case EOps::ReAhead:
+    case EOps::ReNAhead:
+    case EOps::ReBehind:
+    case EOps::ReNBehind: {
+      if (!nativeChain(code, name, param))
+        return false;
+      bool behind = re->op == EOps::ReBehind || re->op == EOps::ReNBehind;
+      std::string from = behind ? "p - " + std::to_string(re->param0) : "p";
+      std::string look = nodeName(name, param) + "(m, " + from + ", [](int) { return true; })";
+      if (re->op == EOps::ReAhead)
+        body = "  if (!" + look + ")\n    return false;\n";
+      else if (re->op == EOps::ReNAhead)
+        body = "  if (" + look + ")\n    return false;\n";
+      else if (re->op == EOps::ReBehind)
+        body = "  if (" + from + " < 0 || !" + look + ")\n    return false;\n";
+      else
+        body = "  if (" + from + " >= 0 && " + look + ")\n    return false;\n";
+      body += "  return " + next + ";\n";
+      break;
+    }
+    case EOps::ReRangeN:
+    case EOps::ReRangeNM:
+    case EOps::ReNGRangeN:
+    case EOps::ReNGRangeNM: {
+      if (!param)
+        return false;
+      bool greedy = re->op == EOps::ReRangeN || re->op == EOps::ReRangeNM;
+      bool bounded = re->op == EOps::ReRangeNM || re->op == EOps::ReNGRangeNM;
+      std::string min = std::to_string(re->s);
+      std::string max = std::to_string(re->e);
+      // optional chain, counters of the longer ranges are not restored by the engines on
+      // backtracking, so the generated code follows them only for the single symbols
+      if (param->next || !nativeAtom(code, name, param)) {
+        if (!bounded || re->s != 0 || re->e != 1 || !nativeChain(code, name, param))
+          return false;
+        std::string once = nodeName(name, param) + "(m, p, [&](int q) { return " + nextCall(name, re, "q") + "; })";
+        if (greedy)
+          body = "  if (" + once + ")\n    return true;\n  return " + next + ";\n";
+        else
+          body = "  if (" + next + ")\n    return true;\n  return " + once + ";\n";
+        break;
+      }
+      std::string atom = atomName(name, param);
+      std::string nextq = nextCall(name, re, "q");
+      if (greedy) {
+        // symbols are counted forward, then given back one by one
+        std::string back = isCodePointAtom(param)
+                               ? "(m.surrogates && q - 2 >= p && U16_IS_TRAIL(m.text[q - 1]) && "
+                                 "U16_IS_LEAD(m.text[q - 2]) ? 2 : 1)"
+                               : "1";
+        body = "  int n = 0;\n  int q = p;\n  for (int r; " + (bounded ? "n < " + max + " && " : std::string()) +
+               "(r = " + atom + "(m, q)) >= 0; n++)\n    q = r;\n  if (n < " + min +
+               ")\n    return false;\n  while (!" + nextq + ") {\n    if (n == " + min +
+               " || m.stepLimitHit)\n      return false;\n    n--;\n    q -= " + back +
+               ";\n  }\n  return true;\n";
+      }
+      else {
+        body = "  int q = p;\n";
+        if (re->s)
+          body += "  for (int n = 0; n < " + min + "; n++) {\n    q = " + atom +
+                  "(m, q);\n    if (q < 0)\n      return false;\n  }\n";
+        if (bounded)
+          body += "  for (int n = " + min + "; !" + nextq + "; n++) {\n    if (n == " + max +
+                  " || m.stepLimitHit)\n      return false;\n";
+        else
+          body += "  while (!" + nextq + ") {\n    if (m.stepLimitHit)\n      return false;\n";
+        body += "    q = " + atom + "(m, q);\n    if (q < 0)\n      return false;\n  }\n  return true;\n";
+      }
+      break;
+    }
+    default:
+      return false;
+  }
+  code += "template <class K>\nstatic bool " + nodeName(name, re) +
+          "(SNativeMatch& m, int p, const K& k)\n{\n  if (!m.step())\n    return false;\n" + body + "}\n\n";
+  return true;
+}
+
+bool CRegExp::generateNative(std::string& code, const std::string& name) const
+{
+  // special kinds are matched directly
+  if (error != EError::EOK || kind != EReKind::General)
+    return false;
+  std::string fns;
+  if (!nativeNode(fns, name, tree_root))
+    return false;
+  code += fns;
+  code += "static bool " + name + "(SNativeMatch& m, int pos)\n{\n  return " + nodeName(name, tree_root) +
+          "(m, pos, [](int) { return true; });\n}\n\n";
+  return true;
+}
+
+#endif
@@ -0,0 +1,623 @@
+#include "colorer/cregexp/cregexp.h"
+#include "colorer/common/UStr.h"
+
+#ifndef NAMED_MATCHES_IN_HASH
+
+////////////////////////////////////////////////////////////////////////////
+// RE tree to program compiler
+
+void CRegExp::compileProgram(const SRegInfo* re)
+{
+  for (; re; re = re->next) {
+    SReInstr& in = program[re->id];
+    in.symbol = in.symbol2 = 0;
+    in.param0 = re->param0;
+    in.s = re->s;
+    in.e = re->e;
+    in.un.word = nullptr;
+    in.child = -1;
+    in.leave = -1;
+    if (re->next) {
+      in.next = re->next->id;
+      in.nextEnter = true;
+    }
+    else {
+      in.next = re->parent ? re->parent->id : -1;
+      in.nextEnter = false;
+    }
+
+    switch (re->op) {
+      case EOps::ReBrackets:
+      case EOps::ReNamedBrackets:
+        if (re->param0 == -1)
+          in.op = EReCode::ReGroup;
+        else
+          in.op = re->op == EOps::ReBrackets ? EReCode::ReBrackets : EReCode::ReNamedBrackets;
+        break;
+      case EOps::ReSymb:
+        if (ignoreCase) {
+          in.op = EReCode::ReSymbNoCase;
+          in.symbol = UStr::toLowerCase(re->un.symbol);
+          in.symbol2 = UStr::toUpperCase(re->un.symbol);
+        }
+        else {
+          in.op = EReCode::ReSymb;
+          in.symbol = re->un.symbol;
+        }
+        break;
+      case EOps::ReWord:
+        if (!ignoreCase)
+          in.op = EReCode::ReWord;
+        else
+          in.op = re->param0 ? EReCode::ReWordFold : EReCode::ReWordNoCase;
+        in.un.word = re->un.word;
+        break;
+      case EOps::ReMetaSymb:
+        in.op = EReCode::ReMetaSymb;
+        in.un.metaSymbol = re->un.metaSymbol;
+        break;
+      case EOps::ReEnum:
+        in.op = EReCode::ReEnum;
+        in.un.charclass = re->un.charclass;
+        break;
+      case EOps::ReNEnum:
+        in.op = EReCode::ReNEnum;
+        in.un.charclass = re->un.charclass;
+        break;
+#ifdef COLORERMODE
+      case EOps::ReBkTrace:
+        in.op = EReCode::ReBkTrace;
+        break;
+      case EOps::ReBkTraceN:
+        in.op = EReCode::ReBkTraceN;
+        break;
+      case EOps::ReBkTraceName:
+        in.op = EReCode::ReBkTraceName;
+        break;
+      case EOps::ReBkTraceNName:
+        in.op = EReCode::ReBkTraceNName;
+        break;
+#endif
+      case EOps::ReBkBrack:
+        in.op = EReCode::ReBkBrack;
+        break;
+      case EOps::ReBkBrackName:
+        in.op = EReCode::ReBkBrackName;
+        break;
+      case EOps::ReAhead:
+        in.op = EReCode::ReAhead;
+        break;
+      case EOps::ReNAhead:
+        in.op = EReCode::ReNAhead;
+        break;
+      case EOps::ReBehind:
+        in.op = EReCode::ReBehind;
+        break;
+      case EOps::ReNBehind:
+        in.op = EReCode::ReNBehind;
+        break;
+      case EOps::ReOr: {
+        in.op = EReCode::ReOr;
+        // alternative is leaved through the parent of the last node in the chain
+        const SRegInfo* last = re;
+        while (last->next) last = last->next;
+        in.leave = last->parent ? last->parent->id : -1;
+      } break;
+      case EOps::ReRangeN:
+        in.op = EReCode::ReRangeN;
+        break;
+      case EOps::ReRangeNM:
+        in.op = EReCode::ReRangeNM;
+        break;
+      case EOps::ReNGRangeN:
+        in.op = EReCode::ReNGRangeN;
+        break;
+      case EOps::ReNGRangeNM:
+        in.op = EReCode::ReNGRangeNM;
+        break;
+      default:
+        in.op = EReCode::ReEmpty;
+        break;
+    }
+
+    if (re->op > EOps::ReBlockOps &&
+        (re->op < EOps::ReSymbolOps || re->op == EOps::ReBrackets ||
+         re->op == EOps::ReNamedBrackets))
+    {
+      in.child = re->un.param->id;
+      compileProgram(re->un.param);
+    }
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////
+// program interpreter
+//
+// It repeats CRegExp::lowParse step by step, but works with the flat
+// instruction array and the compact backtracking frames.
+
+bool CRegExp::programParse(MatchState& st, int toParse) const
+{
+  const SReInstr* prog = program.data();
+  RegExpContext* context = st.context;
+  SRegState* nodes = st.nodes;
+  const UnicodeString& pattern = *st.global_pattern;
+  const int end = st.end;
+  SMatches* matches = st.matches;
+#ifdef COLORERMODE
+  const UnicodeString* backStr = st.backStr;
+  const SMatches* backTrace = st.backTrace;
+#endif
+  int re = 0;
+  bool leftenter = true;
+  int action = -1;
+  int i, sv, wlen;
+  bool br;
+
+  // returns to the last branch point
+  auto pop = [&](bool res) {
+    if (context->count_elem == 0) {
+      action = res;
+      return;
+    }
+    const SReFrame& ne = context->frames[--context->count_elem];
+    action = res ? ne.ifTrueReturn : ne.ifFalseReturn;
+    re = ne.re;
+    toParse = ne.toParse;
+    leftenter = ne.leftenter;
+  };
+  // saves current position as the branch point
+  auto push = [&](int ifTrueReturn, int ifFalseReturn) {
+    if (context->frames_size == context->count_elem) {
+      int size = context->frames_size ? context->frames_size * 2 : INIT_MEM_SIZE;
+      auto* frames = new SReFrame[size];
+      if (context->count_elem)
+        memcpy(frames, context->frames, context->count_elem * sizeof(SReFrame));
+      delete[] context->frames;
+      context->frames = frames;
+      context->frames_size = size;
+    }
+    SReFrame& ne = context->frames[context->count_elem++];
+    if (context->count_elem > context->peak_elem)
+      context->peak_elem = context->count_elem;
+    ne.re = re;
+    ne.toParse = toParse;
+    ne.leftenter = leftenter;
+    ne.ifTrueReturn = static_cast<char>(ifTrueReturn);
+    ne.ifFalseReturn = static_cast<char>(ifFalseReturn);
+  };
+  // branch into the operand of current node
+  auto pushChild = [&](int ifTrueReturn, int ifFalseReturn, int toParse2) {
+    push(ifTrueReturn, ifFalseReturn);
+    re = prog[re].child;
+    toParse = toParse2;
+    leftenter = true;
+  };
+  // branch over current node
+  auto pushNext = [&](int ifTrueReturn, int ifFalseReturn) {
+    push(ifTrueReturn, ifFalseReturn);
+    leftenter = prog[re].nextEnter;
+    re = prog[re].next;
+  };
+
+  while (true) {
+    while (re != -1 || action != -1) {
+      if (st.stepLimit && ++st.steps > st.stepLimit) {
+        st.stepLimitHit = true;
+        return false;
+      }
+      if (re != -1 && action == -1) {
+        const SReInstr& in = prog[re];
+        switch (in.op) {
+          case EReCode::ReEmpty:
+            break;
+          case EReCode::ReGroup:
+            if (leftenter) {
+              re = in.child;
+              continue;
+            }
+            break;
+          case EReCode::ReBrackets:
+            if (leftenter) {
+              nodes[re].s = toParse;
+              re = in.child;
+              continue;
+            }
+            if (in.param0 || !st.startChange)
+              matches->s[in.param0] = nodes[re].s;
+            if (in.param0 || !st.endChange)
+              matches->e[in.param0] = toParse;
+            if (matches->e[in.param0] < matches->s[in.param0])
+              matches->s[in.param0] = matches->e[in.param0];
+            break;
+          case EReCode::ReNamedBrackets:
+            if (leftenter) {
+              nodes[re].s = toParse;
+              re = in.child;
+              continue;
+            }
+            matches->ns[in.param0] = nodes[re].s;
+            matches->ne[in.param0] = toParse;
+            if (matches->ne[in.param0] < matches->ns[in.param0])
+              matches->ns[in.param0] = matches->ne[in.param0];
+            break;
+          case EReCode::ReSymb:
+            if (toParse >= end || pattern[toParse] != in.symbol) {
+              pop(false);
+              continue;
+            }
+            toParse++;
+            break;
+          case EReCode::ReSymbNoCase:
+            if (toParse >= end || (UStr::toLowerCase(pattern[toParse]) != in.symbol &&
+                                   UStr::toUpperCase(pattern[toParse]) != in.symbol2))
+            {
+              pop(false);
+              continue;
+            }
+            toParse++;
+            break;
+          case EReCode::ReMetaSymb:
+            if (!checkMetaSymbol(st, in.un.metaSymbol, toParse)) {
+              pop(false);
+              continue;
+            }
+            break;
+          case EReCode::ReWord:
+            wlen = in.un.word->length();
+            if (toParse + wlen > end) {
+              pop(false);
+              continue;
+            }
+            br = false;
+            for (i = 0; i < wlen; i++) {
+              if (pattern[toParse + i] != (*in.un.word)[i]) {
+                br = true;
+                break;
+              }
+            }
+            if (br) {
+              pop(false);
+              continue;
+            }
+            toParse += wlen;
+            break;
+          case EReCode::ReWordNoCase:
+            wlen = in.un.word->length();
+            if (toParse + wlen > end ||
+                UnicodeString(pattern, toParse, wlen).caseCompare(*in.un.word, 0) != 0)
+            {
+              pop(false);
+              continue;
+            }
+            toParse += wlen;
+            break;
+          case EReCode::ReWordFold:
+            wlen = in.un.word->length();
+            if (toParse + wlen > end) {
+              pop(false);
+              continue;
+            }
+            br = false;
+            for (i = 0; i < wlen; i++) {
+              if (UStr::foldCase(pattern[toParse + i]) != (*in.un.word)[i]) {
+                br = true;
+                break;
+              }
+            }
+            if (br) {
+              pop(false);
+              continue;
+            }
+            toParse += wlen;
+            break;
+          case EReCode::ReEnum:
+          case EReCode::ReNEnum:
+            if (!checkClass(st, in.un.charclass, in.op == EReCode::ReNEnum, toParse)) {
+              pop(false);
+              continue;
+            }
+            break;
+#ifdef COLORERMODE
+          case EReCode::ReBkTrace:
+          case EReCode::ReBkTraceName:
+            sv = in.param0;
+            if (!backStr || !backTrace || sv == -1) {
+              pop(false);
+              continue;
+            }
+            br = false;
+            if (in.op == EReCode::ReBkTrace)
+              i = backTrace->s[sv], wlen = backTrace->e[sv];
+            else
+              i = backTrace->ns[sv], wlen = backTrace->ne[sv];
+            for (; i < wlen; i++) {
+              if (toParse >= end || pattern[toParse] != (*backStr)[i]) {
+                br = true;
+                break;
+              }
+              toParse++;
+            }
+            if (br) {
+              pop(false);
+              continue;
+            }
+            break;
+          case EReCode::ReBkTraceN:
+          case EReCode::ReBkTraceNName:
+            sv = in.param0;
+            if (!backStr || !backTrace || sv == -1) {
+              pop(false);
+              continue;
+            }
+            br = false;
+            if (in.op == EReCode::ReBkTraceN)
+              i = backTrace->s[sv], wlen = backTrace->e[sv];
+            else
+              i = backTrace->ns[sv], wlen = backTrace->ne[sv];
+            for (; i < wlen; i++) {
+              if (toParse >= end ||
+                  UStr::toLowerCase(pattern[toParse]) != UStr::toLowerCase((*backStr)[i])) {
+                br = true;
+                break;
+              }
+              toParse++;
+            }
+            if (br) {
+              pop(false);
+              continue;
+            }
+            break;
+#endif
+          case EReCode::ReBkBrackName:
+            sv = in.param0;
+            if (sv == -1 || cnMatch <= sv || matches->ns[sv] == -1 || matches->ne[sv] == -1) {
+              pop(false);
+              continue;
+            }
+            br = false;
+            for (i = matches->ns[sv]; i < matches->ne[sv]; i++) {
+              if (toParse >= end || pattern[toParse] != pattern[i]) {
+                br = true;
+                break;
+              }
+              toParse++;
+            }
+            if (br) {
+              pop(false);
+              continue;
+            }
+            break;
+          case EReCode::ReBkBrack:
+            sv = in.param0;
+            if (sv == -1 || cMatch <= sv || matches->s[sv] == -1 || matches->e[sv] == -1) {
+              pop(false);
+              continue;
+            }
+            br = false;
+            for (i = matches->s[sv]; i < matches->e[sv]; i++) {
+              if (toParse >= end || pattern[toParse] != pattern[i]) {
+                br = true;
+                break;
+              }
+              toParse++;
+            }
+            if (br) {
+              pop(false);
+              continue;
+            }
+            break;
+          case EReCode::ReAhead:
+            if (!leftenter) {
+              pop(true);
+              continue;
+            }
+            pushChild(rea_Break, rea_False, toParse);
+            continue;
+          case EReCode::ReNAhead:
+            if (!leftenter) {
+              pop(true);
+              continue;
+            }
+            pushChild(rea_False, rea_Break, toParse);
+            continue;
+          case EReCode::ReBehind:
+            if (!leftenter) {
+              pop(true);
+              continue;
+            }
+            if (toParse - in.param0 < 0) {
+              pop(false);
+              continue;
+            }
+            pushChild(rea_Break, rea_False, toParse - in.param0);
+            continue;
+          case EReCode::ReNBehind:
+            if (!leftenter) {
+              pop(true);
+              continue;
+            }
+            if (toParse - in.param0 >= 0) {
+              pushChild(rea_False, rea_Break, toParse - in.param0);
+              continue;
+            }
+            break;
+          case EReCode::ReOr:
+            if (!leftenter) {
+              re = in.leave;
+              continue;
+            }
+            pushChild(rea_True, rea_Break, toParse);
+            continue;
+          case EReCode::ReRangeN: {
+            SRegState& ns = nodes[re];
+            // first enter into op
+            if (leftenter) {
+              ns.param0 = in.s;
+              ns.oldParse = -1;
+            }
+            if (!ns.param0 && ns.oldParse == toParse)
+              break;
+            ns.oldParse = toParse;
+            // making branch
+            if (!ns.param0) {
+              if (in.param0 != -1 && st.memo) {
+                int state = memoState(st, in.param0, toParse);
+                if (state & MEMO_FAILED) {
+                  pop(false);
+                  continue;
+                }
+                // empty iteration, missed by oldParse check after backtracking
+                if (state & MEMO_ENTERED)
+                  break;
+                memoMark(st, in.param0, toParse, MEMO_ENTERED);
+              }
+              pushChild(rea_True, rea_RangeN_step2, toParse);
+              continue;
+            }
+            // go into
+            ns.param0--;
+            re = in.child;
+            leftenter = true;
+            continue;
+          }
+          case EReCode::ReRangeNM: {
+            SRegState& ns = nodes[re];
+            if (leftenter) {
+              ns.param0 = in.s;
+              ns.param1 = in.e - in.s;
+              ns.oldParse = -1;
+            }
+            if (!ns.param0) {
+              if (!ns.param1) {
+                pushNext(rea_True, rea_False);
+                continue;
+              }
+              ns.param1--;
+              pushChild(rea_True, rea_RangeNM_step2, toParse);
+              continue;
+            }
+            ns.param0--;
+            re = in.child;
+            leftenter = true;
+            continue;
+          }
+          case EReCode::ReNGRangeN: {
+            SRegState& ns = nodes[re];
+            if (leftenter) {
+              ns.param0 = in.s;
+              ns.oldParse = -1;
+            }
+            if (!ns.param0 && ns.oldParse == toParse)
+              break;
+            ns.oldParse = toParse;
+            if (!ns.param0) {
+              if (in.param0 != -1 && st.memo) {
+                int state = memoState(st, in.param0, toParse);
+                if (state & MEMO_FAILED) {
+                  pop(false);
+                  continue;
+                }
+                // empty iteration, missed by oldParse check after backtracking
+                if (state & MEMO_ENTERED)
+                  break;
+                memoMark(st, in.param0, toParse, MEMO_ENTERED);
+              }
+              pushNext(rea_True, rea_NGRangeN_step2);
+              continue;
+            }
+            ns.param0--;
+            re = in.child;
+            leftenter = true;
+            continue;
+          }
+          case EReCode::ReNGRangeNM: {
+            SRegState& ns = nodes[re];
+            if (leftenter) {
+              ns.param0 = in.s;
+              ns.param1 = in.e - in.s;
+              ns.oldParse = -1;
+            }
+            if (!ns.param0) {
+              if (!ns.param1) {
+                pushNext(rea_True, rea_False);
+                continue;
+              }
+              ns.param1--;
+              pushNext(rea_True, rea_NGRangeNM_step2);
+              continue;
+            }
+            ns.param0--;
+            re = in.child;
+            leftenter = true;
+            continue;
+          }
+        }
+      }
+
+      switch (action) {
+        case rea_False:
+          if (context->count_elem) {
+            pop(false);
+            continue;
+          }
+          return false;
+        case rea_True:
+          if (context->count_elem) {
+            pop(true);
+            continue;
+          }
+          return true;
+        case rea_Break:
+          action = -1;
+          break;
+        case rea_RangeN_step2:
+          action = -1;
+          pushNext(rea_True, prog[re].param0 != -1 ? rea_RangeN_fail : rea_False);
+          continue;
+        case rea_RangeNM_step2:
+          action = -1;
+          pushNext(rea_True, rea_RangeNM_step3);
+          continue;
+        case rea_RangeNM_step3:
+          action = -1;
+          nodes[re].param1++;
+          pop(false);
+          continue;
+        case rea_NGRangeN_step2:
+          action = -1;
+          if (nodes[re].param0)
+            nodes[re].param0--;
+          // the last branch of the decision is marked to record its failure, when memo is used
+          if (prog[re].param0 != -1 && (st.memo || startMemo(st))) {
+            pushChild(rea_True, rea_RangeN_fail, toParse);
+            continue;
+          }
+          re = prog[re].child;
+          leftenter = true;
+          continue;
+        case rea_NGRangeNM_step2:
+          action = -1;
+          pushChild(rea_True, rea_NGRangeNM_step3, toParse);
+          continue;
+        case rea_NGRangeNM_step3:
+          action = -1;
+          nodes[re].param1++;
+          pop(false);
+          continue;
+        case rea_RangeN_fail:
+          action = -1;
+          memoMark(st, prog[re].param0, toParse, MEMO_FAILED);
+          pop(false);
+          continue;
+        default:
+          break;
+      }
+      leftenter = prog[re].nextEnter;
+      re = prog[re].next;
+    }
+    pop(true);
+  }
+}
+
+#endif  // NAMED_MATCHES_IN_HASH
@@ -581,4 +581,14 @@ int BaseEditor::getInvalidLine() const
 void BaseEditor::setMaxBlockSize(int max_block_size)
 {
   textParser->setMaxBlockSize(max_block_size);
+}
+
+void BaseEditor::setRegExpStepLimit(int step_limit)
+{
+  textParser->setRegExpStepLimit(step_limit);
+}
+
+void BaseEditor::setRegExpProfile(RegExpProfile* profile)
+{
+  textParser->setRegExpProfile(profile);
 }
\ No newline at end of file
@@ -244,6 +244,8 @@ class BaseEditor : public RegionHandler
 
   bool haveInvalidLine();
   void setMaxBlockSize(int max_block_size);
+  void setRegExpStepLimit(int step_limit);
+  void setRegExpProfile(RegExpProfile* profile);
 
  private:
   FileType* chooseFileTypeCh(const UnicodeString* fileName, int chooseStr, int chooseLen);
@@ -28,6 +28,11 @@ FileType* HrcLibrary::chooseFileType(const UnicodeString* fileName, const Unicod
   return pimpl->chooseFileType(fileName, firstLine, typeNo);
 }
 
+FileType* HrcLibrary::chooseFileTypeOf(const UnicodeString* filePath, LineSource* lineSource)
+{
+  return pimpl->chooseFileTypeOf(filePath, lineSource);
+}
+
 size_t HrcLibrary::getFileTypesCount()
 {
   return pimpl->getFileTypesCount();
@@ -48,7 +53,22 @@ const Region* HrcLibrary::getRegion(const UnicodeString* name)
   return pimpl->getRegion(name);
 }
 
+const UnicodeString* HrcLibrary::getRegExpPattern(const CRegExp* re)
+{
+  return pimpl->getRegExpPattern(re);
+}
+
 void HrcLibrary::loadFileType(FileType* filetype)
 {
   pimpl->loadFileType(filetype);
 }
+
+void HrcLibrary::freeze()
+{
+  pimpl->freeze();
+}
+
+bool HrcLibrary::isFrozen() const
+{
+  return pimpl->isFrozen();
+}
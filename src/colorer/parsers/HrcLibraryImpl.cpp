@@ -2,6 +2,7 @@
 #include <xercesc/parsers/XercesDOMParser.hpp>
 #include <xercesc/util/NumberFormatException.hpp>
 #include <xercesc/util/XMLDouble.hpp>
+#include "colorer/LineSource.h"
 #include "colorer/base/XmlTagDefs.h"
 #include "colorer/common/UStr.h"
 #include "colorer/parsers/FileTypeImpl.h"
@@ -41,6 +42,9 @@ void HrcLibrary::Impl::loadSource(XmlInputSource* is)
   if (!is) {
     throw HrcLibraryException("Can't open stream - 'null' is bad stream.");
   }
+  if (frozen) {
+    throw HrcLibraryException("Can't load stream - library is frozen.");
+  }
 
   XmlInputSource* istemp = current_input_source;
   current_input_source = is;
@@ -84,6 +88,11 @@ void HrcLibrary::Impl::loadFileType(FileType* filetype)
   {
     return;
   }
+  if (frozen) {
+    // type is left as is, the library can be used by other threads
+    spdlog::error("Can't load type '{0}' - library is frozen.", *thisType->getName());
+    return;
+  }
 
   thisType->pimpl->input_source_loading = true;
 
@@ -109,6 +118,23 @@ void HrcLibrary::Impl::loadFileType(FileType* filetype)
   thisType->pimpl->input_source_loading = false;
 }
 
+void HrcLibrary::Impl::freeze()
+{
+  if (frozen) {
+    return;
+  }
+  // loading of the type can add new types to the vector
+  for (size_t idx = 0; idx < fileTypeVector.size(); idx++) {
+    loadFileType(fileTypeVector[idx]);
+  }
+  frozen = true;
+}
+
+bool HrcLibrary::Impl::isFrozen() const
+{
+  return frozen;
+}
+
 FileType* HrcLibrary::Impl::chooseFileType(const UnicodeString* fileName,
                                            const UnicodeString* firstLine, int typeNo)
 {
@@ -133,6 +159,35 @@ FileType* HrcLibrary::Impl::chooseFileType(const UnicodeString* fileName,
   return best;
 }
 
+FileType* HrcLibrary::Impl::chooseFileTypeOf(const UnicodeString* filePath, LineSource* lineSource)
+{
+  // the type is chosen by a few first lines of the text
+  UnicodeString text_start;
+  int total_length = 0;
+  for (size_t i = 0; i < 4; i++) {
+    UnicodeString* line = lineSource->getLine(i);
+    if (line == nullptr) {
+      break;
+    }
+    text_start.append(*line);
+    text_start.append("\n");
+    total_length += line->length();
+    if (total_length > 500) {
+      break;
+    }
+  }
+
+  if (filePath == nullptr) {
+    return chooseFileType(nullptr, &text_start, 0);
+  }
+  auto slash_idx = filePath->lastIndexOf('\\');
+  if (slash_idx == -1) {
+    slash_idx = filePath->lastIndexOf('/');
+  }
+  UnicodeString file_name(*filePath, slash_idx + 1);
+  return chooseFileType(&file_name, &text_start, 0);
+}
+
 FileType* HrcLibrary::Impl::getFileType(const UnicodeString* name)
 {
   if (name == nullptr) {
@@ -179,6 +234,15 @@ const Region* HrcLibrary::Impl::getRegion(const UnicodeString* name)
   return getNCRegion(name, false);  // regionNamesHash.get(name);
 }
 
+const UnicodeString* HrcLibrary::Impl::getRegExpPattern(const CRegExp* re)
+{
+  auto pattern = startRegExpPatterns.find(re);
+  if (pattern == startRegExpPatterns.end()) {
+    return nullptr;
+  }
+  return pattern->second;
+}
+
 // protected methods
 
 void HrcLibrary::Impl::parseHRC(const XmlInputSource& is)
@@ -616,6 +680,7 @@ void HrcLibrary::Impl::addScheme(const xercesc::DOMElement* elem)
     return;
   }
   parseSchemeBlock(scheme, elem);
+  scheme->buildCandidates();
 }
 
 void HrcLibrary::Impl::parseSchemeBlock(SchemeImpl* scheme, const xercesc::DOMNode* elem)
@@ -731,14 +796,16 @@ void HrcLibrary::Impl::addSchemeRegexp(SchemeImpl* scheme, const xercesc::DOMEle
   UnicodeString dhrcRegexpAttrPriority = UnicodeString(elem->getAttribute(hrcRegexpAttrPriority));
   scheme_node->lowPriority = UnicodeString("low").compare(dhrcRegexpAttrPriority) == 0;
   scheme_node->type = SchemeNode::SchemeNodeType::SNT_RE;
-  scheme_node->start = std::make_unique<CRegExp>(entMatchParam.get());
-  if (!scheme_node->start || !scheme_node->start->isOk()) {
+  scheme_node->start = getStartRegExp(entMatchParam.get());
+  if (!scheme_node->start->isOk()) {
     spdlog::error("fault compiling regexp '{0}' in scheme '{1}'", *entMatchParam,
                   *scheme->schemeName.get());
     return;
   }
-  scheme_node->start->setPositionMoves(false);
   scheme_node->end = nullptr;
+#ifdef COLORER_USE_REGEXP_ANALYSIS
+  checkRegExp(scheme_node->start.get(), entMatchParam.get(), scheme);
+#endif
 
   loadRegions(scheme_node.get(), elem, true);
   if (scheme_node->region) {
@@ -828,20 +895,20 @@ void HrcLibrary::Impl::addSchemeBlock(SchemeImpl* scheme, const xercesc::DOMElem
   scheme_node->lowContentPriority = UnicodeString("low").compare(attr_cpr) == 0;
   scheme_node->innerRegion = UnicodeString("yes").compare(attr_ireg) == 0;
   scheme_node->type = SchemeNode::SchemeNodeType::SNT_SCHEME;
-  scheme_node->start = std::make_unique<CRegExp>(startParam.get());
-  scheme_node->start->setPositionMoves(false);
+  scheme_node->start = getStartRegExp(startParam.get());
   if (!scheme_node->start->isOk()) {
     spdlog::error("fault compiling regexp '{0}' in scheme '{1}'", *startParam.get(),
                   *scheme->schemeName.get());
   }
-  scheme_node->end = std::make_unique<CRegExp>();
-  scheme_node->end->setPositionMoves(true);
-  scheme_node->end->setBackRE(scheme_node->start.get());
-  scheme_node->end->setRE(endParam.get());
+  scheme_node->end = getEndRegExp(scheme_node->start.get(), endParam.get());
   if (!scheme_node->end->isOk()) {
     spdlog::error("fault compiling regexp '{0}' in scheme '{1}'", *endParam.get(),
                   *scheme->schemeName.get());
   }
+#ifdef COLORER_USE_REGEXP_ANALYSIS
+  checkRegExp(scheme_node->start.get(), startParam.get(), scheme);
+  checkRegExp(scheme_node->end.get(), endParam.get(), scheme);
+#endif
 
   // !! EE
   loadBlockRegions(scheme_node.get(), elem);
@@ -1003,6 +1070,68 @@ void HrcLibrary::Impl::loadRegions(SchemeNode* node, const xercesc::DOMElement*
   }
 }
 
+std::shared_ptr<const CRegExp> HrcLibrary::Impl::getStartRegExp(const UnicodeString* pattern)
+{
+  auto cached = startRegExpHash.try_emplace(*pattern).first;
+  auto re = cached->second.lock();
+  if (!re) {
+    auto* new_re = new CRegExp(pattern);
+    new_re->setPositionMoves(false);
+    // matcher, generated for the pattern and compiled into the application
+    new_re->setNative(CRegExp::findNative(*pattern));
+    re = std::shared_ptr<const CRegExp>(new_re, [this, key = *pattern](const CRegExp* dead) {
+      startRegExpPatterns.erase(dead);
+      startRegExpHash.erase(key);
+      delete dead;
+    });
+    cached->second = re;
+    startRegExpPatterns[new_re] = &cached->first;
+  }
+  return re;
+}
+
+#ifdef COLORER_USE_REGEXP_ANALYSIS
+void HrcLibrary::Impl::checkRegExp(const CRegExp* re, const UnicodeString* pattern,
+                                   const SchemeImpl* scheme)
+{
+  for (const auto& ambiguity : re->findAmbiguities()) {
+    const char* kind = ambiguity.kind == EReAmbiguity::NestedRepeat ? "nested repeat"
+                                                                     : "overlapping alternatives";
+    std::string bounds = std::to_string(ambiguity.s) + "," +
+                         (ambiguity.e == -1 ? std::string() : std::to_string(ambiguity.e));
+    if (ambiguity.exponential) {
+      spdlog::warn("regexp '{0}' in scheme '{1}' has ambiguous repeat {{{2}}} ({3}), "
+                   "failing match can take exponential time",
+                   *pattern, *scheme->schemeName.get(), bounds, kind);
+    }
+    else {
+      spdlog::debug("regexp '{0}' in scheme '{1}' has ambiguous repeat {{{2}}} ({3})", *pattern,
+                    *scheme->schemeName.get(), bounds, kind);
+    }
+  }
+}
+#endif
+
+std::shared_ptr<const CRegExp> HrcLibrary::Impl::getEndRegExp(const CRegExp* start, const UnicodeString* pattern)
+{
+  std::pair<const CRegExp*, UnicodeString> key {start, *pattern};
+  auto& cached = endRegExpHash[key];
+  auto re = cached.lock();
+  if (!re) {
+    auto* new_re = new CRegExp();
+    new_re->setPositionMoves(true);
+    new_re->setBackRE(start);
+    new_re->setRE(pattern);
+    // nodes of the end regexp hold its start, so the key is removed before the start is freed
+    re = std::shared_ptr<const CRegExp>(new_re, [this, key](const CRegExp* dead) {
+      endRegExpHash.erase(key);
+      delete dead;
+    });
+    cached = re;
+  }
+  return re;
+}
+
 void HrcLibrary::Impl::loadBlockRegions(SchemeNode* node, const xercesc::DOMElement* el)
 {
   int i;
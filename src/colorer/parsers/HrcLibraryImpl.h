@@ -2,6 +2,7 @@
 #define _COLORER_HRCLIBRARYIMPL_H_
 
 #include <xercesc/dom/DOM.hpp>
+#include <map>
 #include "colorer/HrcLibrary.h"
 #include "colorer/cregexp/cregexp.h"
 #include "colorer/parsers/SchemeImpl.h"
@@ -27,11 +28,15 @@ class HrcLibrary::Impl
   FileType* enumerateFileTypes(unsigned int index);
   FileType* chooseFileType(const UnicodeString* fileName, const UnicodeString* firstLine,
                            int typeNo = 0);
+  FileType* chooseFileTypeOf(const UnicodeString* filePath, LineSource* lineSource);
   size_t getFileTypesCount();
 
   size_t getRegionCount();
   const Region* getRegion(unsigned int id);
   const Region* getRegion(const UnicodeString* name);
+  const UnicodeString* getRegExpPattern(const CRegExp* re);
+  void freeze();
+  bool isFrozen() const;
 
  protected:
   enum class QualifyNameType { QNT_DEFINE, QNT_SCHEME, QNT_ENTITY };
@@ -48,10 +53,20 @@ class HrcLibrary::Impl
   std::unordered_map<UnicodeString, const Region*> regionNamesHash;
   std::unordered_map<UnicodeString, UnicodeString*> schemeEntitiesHash;
 
+  // compiled regexps, shared by nodes with the same (entity expanded) patterns;
+  // entries are removed by the deleter of the regexp, when its last node is deleted
+  std::unordered_map<UnicodeString, std::weak_ptr<const CRegExp>> startRegExpHash;
+  // patterns of the start regexps, keys of startRegExpHash
+  std::unordered_map<const CRegExp*, const UnicodeString*> startRegExpPatterns;
+  // block end regexps depend on the start regexp, which is used to resolve \y{name}
+  std::map<std::pair<const CRegExp*, UnicodeString>, std::weak_ptr<const CRegExp>> endRegExpHash;
+
   FileType* current_parse_type = nullptr;
   XmlInputSource* current_input_source = nullptr;
   bool structureChanged = false;
   bool updateStarted = false;
+  // library is read only, see HrcLibrary::freeze
+  bool frozen = false;
 
   void unloadFileType(FileType* filetype);
 
@@ -79,6 +94,11 @@ class HrcLibrary::Impl
   void addKeyword(SchemeNode* scheme_node, const Region* brgn, const xercesc::DOMElement* elem);
   void loadBlockRegions(SchemeNode* node, const xercesc::DOMElement* elem);
   void loadRegions(SchemeNode* node, const xercesc::DOMElement* elem, bool st);
+  std::shared_ptr<const CRegExp> getStartRegExp(const UnicodeString* pattern);
+  std::shared_ptr<const CRegExp> getEndRegExp(const CRegExp* start, const UnicodeString* pattern);
+#ifdef COLORER_USE_REGEXP_ANALYSIS
+  void checkRegExp(const CRegExp* re, const UnicodeString* pattern, const SchemeImpl* scheme);
+#endif
 
   UnicodeString* qualifyOwnName(const UnicodeString* name);
   bool checkNameExist(const UnicodeString* name, FileType* parseType, QualifyNameType qntype,
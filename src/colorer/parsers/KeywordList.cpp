@@ -2,7 +2,7 @@
 
 KeywordList::KeywordList()
 {
-  firstChar = std::make_unique<icu::UnicodeSet>();
+  firstChar = std::make_unique<CharacterClass>();
 }
 
 KeywordList::~KeywordList()
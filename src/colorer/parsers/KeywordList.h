@@ -3,7 +3,7 @@
 
 #include "colorer/Common.h"
 #include "colorer/Region.h"
-#include <unicode/uniset.h>
+#include "colorer/common/CharacterClass.h"
 
 /** Information about one parsed keyword.
     Contains keyword, symbol specifier, region reference
@@ -27,7 +27,7 @@ class KeywordList
   int num = 0;
   bool matchCase = false;
   int minKeywordLength = 0;
-  std::unique_ptr<icu::UnicodeSet> firstChar;
+  std::unique_ptr<CharacterClass> firstChar;
   KeywordInfo* kwList = nullptr;
   KeywordList();
   ~KeywordList();
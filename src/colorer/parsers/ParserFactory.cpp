@@ -18,6 +18,13 @@ std::unique_ptr<TextParser> ParserFactory::createTextParser()
   return pimpl->createTextParser();
 }
 
+size_t ParserFactory::colorizeBatch(
+    const std::vector<UnicodeString>& files, unsigned int threads,
+    const std::function<std::unique_ptr<RegionHandler>(size_t)>& createHandler)
+{
+  return pimpl->colorizeBatch(files, threads, createHandler);
+}
+
 std::unique_ptr<StyledHRDMapper> ParserFactory::createStyledMapper(const UnicodeString* classID,
                                                                    const UnicodeString* nameID)
 {
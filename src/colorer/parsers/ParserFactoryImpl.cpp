@@ -1,10 +1,14 @@
 #include "colorer/parsers/ParserFactoryImpl.h"
+#include <algorithm>
+#include <atomic>
 #include <filesystem>
+#include <thread>
 #include "colorer/base/BaseNames.h"
 #include "colorer/common/UStr.h"
 #include "colorer/parsers/CatalogParser.h"
 #include "colorer/parsers/HrcLibraryImpl.h"
 #include "colorer/utils/Environment.h"
+#include "colorer/viewer/TextLinesStore.h"
 
 namespace fs = std::filesystem;
 
@@ -145,6 +149,62 @@ std::unique_ptr<TextParser> ParserFactory::Impl::createTextParser()
   return std::make_unique<TextParser>();
 }
 
+size_t ParserFactory::Impl::colorizeBatch(
+    const std::vector<UnicodeString>& files, unsigned int threads,
+    const std::function<std::unique_ptr<RegionHandler>(size_t)>& createHandler)
+{
+  // parsers only read the library after the freeze
+  hrc_library->freeze();
+
+  if (threads == 0) {
+    threads = std::max(1u, std::thread::hardware_concurrency());
+  }
+  if (threads > files.size()) {
+    threads = static_cast<unsigned int>(files.size());
+  }
+
+  std::atomic<size_t> next_file {0};
+  std::atomic<size_t> parsed {0};
+  auto worker = [&]() {
+    auto text_parser = createTextParser();
+    for (size_t idx = next_file++; idx < files.size(); idx = next_file++) {
+      try {
+        TextLinesStore lines;
+        lines.loadFile(&files[idx], false);
+        auto* type = hrc_library->chooseFileTypeOf(&files[idx], &lines);
+        if (type == nullptr || type->getBaseScheme() == nullptr) {
+          spdlog::error("Can't colorize '{0}' - no loaded file type.", files[idx]);
+          continue;
+        }
+        auto region_handler = createHandler(idx);
+        text_parser->setFileType(type);
+        text_parser->setLineSource(&lines);
+        text_parser->setRegionHandler(region_handler.get());
+        text_parser->parse(0, static_cast<int>(lines.getLineCount()),
+                           TextParser::TextParseMode::TPM_CACHE_OFF);
+        text_parser->setLineSource(nullptr);
+        text_parser->setRegionHandler(nullptr);
+        ++parsed;
+      } catch (std::exception& e) {
+        // exception must not leave the thread
+        spdlog::error("Can't colorize '{0}': {1}", files[idx], e.what());
+        text_parser->setLineSource(nullptr);
+        text_parser->setRegionHandler(nullptr);
+      }
+    }
+  };
+
+  std::vector<std::thread> workers;
+  for (unsigned int i = 1; i < threads; i++) {
+    workers.emplace_back(worker);
+  }
+  worker();
+  for (auto& thread : workers) {
+    thread.join();
+  }
+  return parsed;
+}
+
 std::unique_ptr<StyledHRDMapper> ParserFactory::Impl::createStyledMapper(
     const UnicodeString* classID, const UnicodeString* nameID)
 {
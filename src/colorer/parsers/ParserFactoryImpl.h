@@ -23,6 +23,8 @@ class ParserFactory::Impl
   void loadHrcPath(const UnicodeString& location);
   [[nodiscard]] HrcLibrary& getHrcLibrary() const;
   static std::unique_ptr<TextParser> createTextParser();
+  size_t colorizeBatch(const std::vector<UnicodeString>& files, unsigned int threads,
+                       const std::function<std::unique_ptr<RegionHandler>(size_t)>& createHandler);
   std::unique_ptr<StyledHRDMapper> createStyledMapper(const UnicodeString* classID,
                                                       const UnicodeString* nameID);
   std::unique_ptr<TextHRDMapper> createTextMapper(const UnicodeString* nameID);
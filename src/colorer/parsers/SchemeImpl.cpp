@@ -0,0 +1,29 @@
+#include "colorer/parsers/SchemeImpl.h"
+#include <algorithm>
+#include <iterator>
+
+void SchemeImpl::buildCandidates()
+{
+  candidateNodes.clear();
+  inheritNodes.clear();
+  std::fill(std::begin(startMask), std::end(startMask), 0);
+  for (int range = 0; range <= CANDIDATES_ASCII; range++) {
+    candidateOffsets[range] = static_cast<int>(candidateNodes.size());
+    for (size_t idx = 0; idx < nodes.size(); idx++) {
+      const auto& node = nodes[idx];
+      bool inherit = node->type == SchemeNode::SchemeNodeType::SNT_INHERIT;
+      if (range == CANDIDATES_ASCII) {
+        if (node->type != SchemeNode::SchemeNodeType::SNT_EMPTY)
+          candidateNodes.push_back(static_cast<int>(idx));
+        if (inherit)
+          inheritNodes.push_back(static_cast<int>(idx));
+      }
+      else if (node->canStartWith(static_cast<UChar>(range))) {
+        candidateNodes.push_back(static_cast<int>(idx));
+        if (!inherit)
+          startMask[range >> 5] |= 1u << (range & 31);
+      }
+    }
+  }
+  candidateOffsets[CANDIDATES_ASCII + 1] = static_cast<int>(candidateNodes.size());
+}
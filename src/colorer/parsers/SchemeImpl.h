@@ -5,6 +5,7 @@
 #include "colorer/cregexp/cregexp.h"
 #include "colorer/parsers/SchemeNode.h"
 #include <memory>
+#include <utility>
 #include <vector>
 #include "colorer/TextParser.h"
 
@@ -30,10 +31,34 @@ class SchemeImpl : public Scheme
     return fileType;
   }
 
+  /** Range of the nodes indexes in priority order, which can match at the position
+      with the symbol @c c. Symbols out of ASCII and end of line have all the nodes.
+  */
+  [[nodiscard]] std::pair<const int*, const int*> getCandidates(UChar c) const
+  {
+    int range = c < CANDIDATES_ASCII ? c : CANDIDATES_ASCII;
+    const int* list = candidateNodes.data();
+    return {list + candidateOffsets[range], list + candidateOffsets[range + 1]};
+  }
+
+  /** Builds candidate nodes lists for #getCandidates and the start symbols mask.
+      Must be called after all nodes of the scheme are loaded.
+  */
+  void buildCandidates();
+
  protected:
+  static constexpr int CANDIDATES_ASCII = 0x80;
+
   uUnicodeString schemeName;
   std::vector<std::unique_ptr<SchemeNode>> nodes;
   FileType* fileType = nullptr;
+  // nodes indexes for each ASCII symbol, and for all other symbols as the last range
+  std::vector<int> candidateNodes;
+  int candidateOffsets[CANDIDATES_ASCII + 2] = {};
+  // bit mask of ASCII symbols, at which own nodes can match, inherited schemes are not included
+  uint32_t startMask[CANDIDATES_ASCII / 32] = {};
+  // indexes of inherit nodes
+  std::vector<int> inheritNodes;
 
   explicit SchemeImpl(const UnicodeString* sn)
   {
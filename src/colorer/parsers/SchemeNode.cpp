@@ -13,4 +13,20 @@ SchemeNode::~SchemeNode()
     }
     virtualEntryVector.clear();
   }
-}
\ No newline at end of file
+}
+
+bool SchemeNode::canStartWith(UChar c) const
+{
+  switch (type) {
+    case SchemeNodeType::SNT_EMPTY:
+      return false;
+    case SchemeNodeType::SNT_INHERIT:
+      return true;
+    case SchemeNodeType::SNT_KEYWORDS:
+      return kwList->num && kwList->firstChar->contains(c);
+    case SchemeNodeType::SNT_RE:
+    case SchemeNodeType::SNT_SCHEME:
+      return !start || start->canStartWith(c);
+  }
+  return true;
+}
@@ -31,21 +31,27 @@ class SchemeNode
 
   VirtualEntryVector virtualEntryVector;
   std::unique_ptr<KeywordList> kwList;
-  std::unique_ptr<icu::UnicodeSet> worddiv;
+  std::unique_ptr<CharacterClass> worddiv;
 
   const Region* region = nullptr;
   const Region* regions[REGIONS_NUM] = {};
   const Region* regionsn[NAMED_REGIONS_NUM] = {};
   const Region* regione[REGIONS_NUM] = {};
   const Region* regionen[NAMED_REGIONS_NUM] = {};
-  std::unique_ptr<CRegExp> start;
-  std::unique_ptr<CRegExp> end;
+  // compiled regexps are shared between nodes with the same patterns
+  std::shared_ptr<const CRegExp> start;
+  std::shared_ptr<const CRegExp> end;
   bool innerRegion = false;
   bool lowPriority = false;
   bool lowContentPriority = false;
 
   SchemeNode();
   ~SchemeNode();
+
+  /** Checks, if the node can match at the position with the symbol @c c.
+      Inherited schemes are always checked, they have own candidates lists.
+  */
+  [[nodiscard]] bool canStartWith(UChar c) const;
 };
 
 #endif  //_COLORER_SCHEMENODE_H_
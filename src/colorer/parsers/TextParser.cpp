@@ -18,6 +18,11 @@ int TextParser::parse(int from, int num, TextParseMode mode)
   return pimpl->parse(from, num, mode);
 }
 
+int TextParser::parseParallel(int from, int num, unsigned int threads)
+{
+  return pimpl->parseParallel(from, num, threads);
+}
+
 void TextParser::setFileType(FileType* type)
 {
   pimpl->setFileType(type);
@@ -37,3 +42,13 @@ void TextParser::setMaxBlockSize(int max_block_size)
 {
   pimpl->setMaxBlockSize(max_block_size);
 }
+
+void TextParser::setRegExpStepLimit(int step_limit)
+{
+  pimpl->setRegExpStepLimit(step_limit);
+}
+
+void TextParser::setRegExpProfile(RegExpProfile* profile)
+{
+  pimpl->setRegExpProfile(profile);
+}
@@ -1,56 +1,97 @@
 #include "colorer/parsers/TextParserHelpers.h"
+#include <algorithm>
 
 /////////////////////////////////////////////////////////////////////////
 // parser's cache structures
 
-ParseCache::~ParseCache()
+void ParseCache::reset()
 {
-  CTRACE(spdlog::trace("[TPCache] ~ParseCache():{0},{1}-{2}", *scheme->getName(), sline, eline));
-  delete backLine;
-  delete children;
-  prev = nullptr;
+  sline = 0;
+  eline = 0;
+  scheme = nullptr;
+  clender = nullptr;
+  vcache.clear();
+  // releases the copied brackets
+  backLine = UnicodeString();
+  children.clear();
+  parent = nullptr;
+}
 
-  while (next) {
-    ParseCache* tmp;
-    tmp = next;
-    while (tmp->next) {
-      tmp = tmp->next;
+ParseCache* ParseCache::searchLine(int ln, ParseCache** cache)
+{
+  *cache = nullptr;
+  if (sline > ln || eline < ln) {
+    return nullptr;
+  }
+  ParseCache* entry = this;
+  while (true) {
+    CTRACE(spdlog::trace("[TPCache] searchLine() entry:{0},{1}-{2}", *entry->scheme->getName(), entry->sline, entry->eline));
+    // last child, started not after the line
+    auto child = std::upper_bound(entry->children.begin(), entry->children.end(), ln,
+                                  [](int line, const ParseCache* item) { return line < item->sline; });
+    if (child == entry->children.begin()) {
+      return entry;
     }
-    while (tmp->prev) {
-      tmp = tmp->prev;
-      delete tmp->next;
-      tmp->next = nullptr;
+    --child;
+    if ((*child)->eline < ln) {
+      *cache = *child;
+      return entry;
     }
-    delete next;
-    next = nullptr;
+    entry = *child;
   }
-
-  delete[] vcache;
 }
 
-ParseCache* ParseCache::searchLine(int ln, ParseCache** cache)
+ParseCache* ParseCachePool::allocate()
 {
-  ParseCache *r1 = nullptr, *r2 = nullptr, *tmp = this;
-  *cache = nullptr;
-  while (tmp) {
-    CTRACE(spdlog::trace("[TPCache] searchLine() tmp:{0},{1}-{2}", *tmp->scheme->getName(), tmp->sline, tmp->eline));
-    if (tmp->sline <= ln && tmp->eline >= ln) {
-      if (tmp->children) {
-        r1 = tmp->children->searchLine(ln, &r2);
-      }
-      if (r1) {
-        *cache = r2;
-        return r1;
-      }
-      *cache = r2;  // last child
-      return tmp;
+  if (freeEntries.empty()) {
+    blocks.push_back(std::make_unique<ParseCache[]>(PARSE_CACHE_BLOCK_SIZE));
+    for (int i = PARSE_CACHE_BLOCK_SIZE - 1; i >= 0; i--) {
+      freeEntries.push_back(&blocks.back()[i]);
     }
-    if (tmp->sline <= ln) {
-      *cache = tmp;
+  }
+  ParseCache* entry = freeEntries.back();
+  freeEntries.pop_back();
+  return entry;
+}
+
+void ParseCachePool::release(ParseCache* entry)
+{
+  if (!entry) {
+    return;
+  }
+  // free list is the queue of the tree walk
+  size_t pos = freeEntries.size();
+  freeEntries.push_back(entry);
+  for (; pos < freeEntries.size(); pos++) {
+    ParseCache* item = freeEntries[pos];
+    freeEntries.insert(freeEntries.end(), item->children.begin(), item->children.end());
+    item->reset();
+  }
+}
+
+void ParseCachePool::releaseChildren(ParseCache* entry, const ParseCache* after)
+{
+  auto& children = entry->children;
+  auto from = children.begin();
+  if (after) {
+    from = std::upper_bound(children.begin(), children.end(), after->sline,
+                            [](int line, const ParseCache* item) { return line < item->sline; });
+  }
+  for (auto it = from; it != children.end(); ++it) {
+    release(*it);
+  }
+  children.erase(from, children.end());
+}
+
+void ParseCachePool::releaseAll()
+{
+  freeEntries.clear();
+  for (auto& block : blocks) {
+    for (int i = PARSE_CACHE_BLOCK_SIZE - 1; i >= 0; i--) {
+      block[i].reset();
+      freeEntries.push_back(&block[i]);
     }
-    tmp = tmp->next;
   }
-  return nullptr;
 }
 
 /////////////////////////////////////////////////////////////////////////
@@ -62,6 +103,7 @@ VTList::VTList()
   last = this;
   shadowlast = nullptr;
   nodesnum = 0;
+  freeItems = nullptr;
 }
 
 VTList::~VTList()
@@ -71,6 +113,9 @@ VTList::~VTList()
   if (!prev && next) {
     next->deltree();
   }
+  if (!prev && freeItems) {
+    freeItems->deltree();
+  }
 }
 
 void VTList::deltree()
@@ -87,7 +132,7 @@ bool VTList::push(SchemeNode* node)
   if (!node || node->virtualEntryVector.empty()) {
     return false;
   }
-  newitem = new VTList();
+  newitem = newItem();
   if (last->next) {
     last->next->prev = newitem;
     newitem->next = last->next;
@@ -110,7 +155,7 @@ bool VTList::pop()
   }
   ditem->prev->next = ditem->next;
   last = ditem->prev;
-  delete ditem;
+  freeItem(ditem);
   nodesnum--;
   return true;
 }
@@ -149,46 +194,135 @@ void VTList::clear()
 {
   nodesnum = 0;
   if (!prev && next) {
-    next->deltree();
+    for (VTList* item = next; item;) {
+      VTList* following = item->next;
+      freeItem(item);
+      item = following;
+    }
     next = nullptr;
   }
   last = this;
 }
 
-VirtualEntryVector** VTList::store()
+void VTList::store(std::vector<VirtualEntryVector*>& store)
 {
-  VirtualEntryVector** store;
-  int i = 0;
+  store.clear();
   if (!nodesnum || last == this) {
-    return nullptr;
+    return;
   }
-  store = new VirtualEntryVector*[nodesnum + 1];
   for (VTList* list = this->next; list; list = list->next) {
-    store[i++] = list->vlist;
+    store.push_back(list->vlist);
     if (list == this->last) {
       break;
     }
   }
-  store[i] = nullptr;
-  return store;
 }
 
-bool VTList::restore(VirtualEntryVector** store)
+bool VTList::restore(const std::vector<VirtualEntryVector*>& store)
 {
   VTList* prevpos = nullptr;
   VTList* pos = this;
-  if (next || prev || !store) {
+  if (next || prev || store.empty()) {
     return false;
   }
 
-  for (int i = 0; store[i] != nullptr; i++) {
-    pos->next = new VTList;
+  for (auto* vector : store) {
+    pos->next = newItem();
     prevpos = pos;
     pos = pos->next;
     pos->prev = prevpos;
-    pos->vlist = store[i];
+    pos->vlist = vector;
     nodesnum++;
   }
   last = pos;
   return true;
 }
+
+VTList* VTList::newItem()
+{
+  if (!freeItems) {
+    return new VTList();
+  }
+  VTList* item = freeItems;
+  freeItems = item->next;
+  item->prev = item->next = nullptr;
+  item->vlist = nullptr;
+  item->shadowlast = nullptr;
+  return item;
+}
+
+void VTList::freeItem(VTList* item)
+{
+  item->prev = this;
+  item->next = freeItems;
+  freeItems = item;
+}
+
+/////////////////////////////////////////////////////////////////////////
+// parse events of the chunk
+
+void RegionBuffer::clearLine(size_t lno, UnicodeString* line)
+{
+  events.push_back({EventType::CLEAR_LINE, 0, 0, lno, copyLine(lno, line), nullptr, nullptr});
+}
+
+void RegionBuffer::addRegion(size_t lno, UnicodeString* line, int sx, int ex, const Region* region)
+{
+  events.push_back({EventType::ADD_REGION, sx, ex, lno, copyLine(lno, line), region, nullptr});
+}
+
+void RegionBuffer::enterScheme(size_t lno, UnicodeString* line, int sx, int ex,
+                               const Region* region, const Scheme* scheme)
+{
+  events.push_back({EventType::ENTER_SCHEME, sx, ex, lno, copyLine(lno, line), region, scheme});
+}
+
+void RegionBuffer::leaveScheme(size_t lno, UnicodeString* line, int sx, int ex,
+                               const Region* region, const Scheme* scheme)
+{
+  events.push_back({EventType::LEAVE_SCHEME, sx, ex, lno, copyLine(lno, line), region, scheme});
+}
+
+void RegionBuffer::replay(RegionHandler* handler, size_t from_line) const
+{
+  for (const auto& event : events) {
+    if (event.lno < from_line) {
+      continue;
+    }
+    switch (event.type) {
+      case EventType::CLEAR_LINE:
+        handler->clearLine(event.lno, event.line);
+        break;
+      case EventType::ADD_REGION:
+        handler->addRegion(event.lno, event.line, event.sx, event.ex, event.region);
+        break;
+      case EventType::ENTER_SCHEME:
+        handler->enterScheme(event.lno, event.line, event.sx, event.ex, event.region, event.scheme);
+        break;
+      case EventType::LEAVE_SCHEME:
+        handler->leaveScheme(event.lno, event.line, event.sx, event.ex, event.region, event.scheme);
+        break;
+    }
+  }
+}
+
+void RegionBuffer::clear()
+{
+  events.clear();
+  events.shrink_to_fit();
+  lines.clear();
+  lines.shrink_to_fit();
+}
+
+UnicodeString* RegionBuffer::copyLine(size_t lno, UnicodeString* line)
+{
+  if (!line) {
+    return nullptr;
+  }
+  // events of one line follow each other
+  if (lines.empty() || lastLine != lno) {
+    lines.push_back(*line);
+    lastLine = lno;
+  }
+  return &lines.back();
+}
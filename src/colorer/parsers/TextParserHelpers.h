@@ -1,7 +1,9 @@
 #ifndef _COLORER_TEXTPARSERPELPERS_H_
 #define _COLORER_TEXTPARSERPELPERS_H_
 
+#include "colorer/RegionHandler.h"
 #include "colorer/parsers/HrcLibraryImpl.h"
+#include <deque>
 
 #if !defined COLORERMODE || defined NAMED_MATCHES_IN_HASH
 #error need (COLORERMODE & !NAMED_MATCHES_IN_HASH) in cregexp
@@ -22,6 +24,11 @@ class VTList
   VirtualEntryVector* vlist;
   VTList *prev, *next, *last, *shadowlast;
   int nodesnum;
+  // removed items of the root are reused, they are linked by next and keep the root in prev
+  VTList* freeItems;
+
+  VTList* newItem();
+  void freeItem(VTList* item);
 
  public:
   VTList();
@@ -32,8 +39,8 @@ class VTList
   SchemeImpl* pushvirt(SchemeImpl* scheme);
   void popvirt();
   void clear();
-  VirtualEntryVector** store();
-  bool restore(VirtualEntryVector** store);
+  void store(std::vector<VirtualEntryVector*>& store);
+  bool restore(const std::vector<VirtualEntryVector*>& store);
 };
 
 /**
@@ -60,28 +67,33 @@ class ParseCache
   /**
    * Scheme virtualization cache entry
    */
-  VirtualEntryVector** vcache = nullptr;
+  std::vector<VirtualEntryVector*> vcache;
 
   /**
-   * RE Match object for start RE of the enwrapped &lt;block> object
+   * RE Match object for start RE of the enwrapped &lt;block> object,
+   * positions of the brackets are in #backLine
    */
   SMatches matchstart = {};
   /**
-   * Copy of the line with parent's start RE.
+   * Brackets of the start RE match, used by \y \Y of the end RE,
+   * empty if the end RE has no such operators.
    */
-  UnicodeString* backLine = nullptr;
+  UnicodeString backLine;
 
   /**
-   * Tree structure references in parse cache
+   * Tree structure references in parse cache.
+   * Children don't overlap and are sorted by the lines.
    */
-  ParseCache* children = nullptr;
-  ParseCache* next = nullptr;
-  ParseCache* prev = nullptr;
+  std::vector<ParseCache*> children;
   ParseCache* parent = nullptr;
   ParseCache() = default;
-  ~ParseCache();
+  /**
+   * Clears the entry before the reuse, keeps allocated memory.
+   */
+  void reset();
   /**
    * Searched a cache position for the specified line number.
+   * Children of each level are found by the binary search.
    * @param ln     Line number to search for
    * @param cache  Cache entry, filled with last child cache entry.
    * @return       Cache entry, assigned to the specified line number
@@ -89,4 +101,81 @@ class ParseCache
   ParseCache* searchLine(int ln, ParseCache** cache);
 };
 
+// number of the parse cache entries, allocated at once
+#define PARSE_CACHE_BLOCK_SIZE 64
+
+/**
+ * Storage of the parse cache entries of one parser.
+ * Entries are allocated by blocks, released entries are reused,
+ * so the parse doesn't call the allocator for each cached block of text.
+ * @ingroup colorer_parsers
+ */
+class ParseCachePool
+{
+ public:
+  ParseCache* allocate();
+  /**
+   * Returns the entry with its children into the pool.
+   */
+  void release(ParseCache* entry);
+  /**
+   * Returns the children of @c entry, which follow the child @c after
+   * (all children, if it is null), into the pool.
+   */
+  void releaseChildren(ParseCache* entry, const ParseCache* after);
+  /**
+   * Returns all entries into the pool.
+   */
+  void releaseAll();
+
+ private:
+  std::vector<std::unique_ptr<ParseCache[]>> blocks;
+  std::vector<ParseCache*> freeEntries;
+};
+
+/**
+ * Stores the parse events of the chunk of text,
+ * parsed in other thread, to pass them to the application's handler later.
+ * Lines of the events are copied, as the line of LineSource is valid only
+ * until its next request.
+ * @ingroup colorer_parsers
+ */
+class RegionBuffer : public RegionHandler
+{
+ public:
+  void clearLine(size_t lno, UnicodeString* line) override;
+  void addRegion(size_t lno, UnicodeString* line, int sx, int ex, const Region* region) override;
+  void enterScheme(size_t lno, UnicodeString* line, int sx, int ex, const Region* region,
+                   const Scheme* scheme) override;
+  void leaveScheme(size_t lno, UnicodeString* line, int sx, int ex, const Region* region,
+                   const Scheme* scheme) override;
+
+  /**
+   * Passes the stored events of the lines, starting from @c from_line, to @c handler.
+   */
+  void replay(RegionHandler* handler, size_t from_line) const;
+  void clear();
+
+ private:
+  enum class EventType { CLEAR_LINE, ADD_REGION, ENTER_SCHEME, LEAVE_SCHEME };
+
+  struct Event
+  {
+    EventType type;
+    int sx;
+    int ex;
+    size_t lno;
+    UnicodeString* line;
+    const Region* region;
+    const Scheme* scheme;
+  };
+
+  UnicodeString* copyLine(size_t lno, UnicodeString* line);
+
+  std::vector<Event> events;
+  // copies of the lines, deque keeps their addresses
+  std::deque<UnicodeString> lines;
+  size_t lastLine = 0;
+};
+
 #endif
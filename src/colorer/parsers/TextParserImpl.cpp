@@ -1,11 +1,21 @@
 #include "colorer/common/UStr.h"
 #include "colorer/parsers/TextParserImpl.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <iterator>
+#include <memory>
+#include <mutex>
+#include <thread>
 
 TextParser::Impl::Impl()
 {
   CTRACE(spdlog::trace("[TextParserImpl] constructor"));
   cache = new ParseCache();
   clearCache();
+  backLines.resize(MAX_RECURSION_LEVEL + 2);
+  regexpContext.setStepLimit(DEFAULT_REGEXP_STEP_LIMIT);
 }
 
 TextParser::Impl::~Impl()
@@ -70,19 +80,11 @@ int TextParser::Impl::parse(int from, int num, TextParseMode mode)
   CTRACE(spdlog::trace("[TextParserImpl] parse: cache filled"));
 
   do {
-    if (!forward) {
-      if (!parent) {
-        return from;
-      }
-      if (updateCache) {
-        delete parent->children;
-        parent->children = nullptr;
-      }
-    } else {
-      if (updateCache) {
-        delete forward->next;
-        forward->next = nullptr;
-      }
+    if (!parent) {
+      return from;
+    }
+    if (updateCache) {
+      cachePool.releaseChildren(parent, forward);
     }
     baseScheme = parent->scheme;
 
@@ -90,11 +92,10 @@ int TextParser::Impl::parse(int from, int num, TextParseMode mode)
     CTRACE(spdlog::trace("[TextParserImpl] parse: goes into colorize()"));
     if (parent != cache) {
       vtlist->restore(parent->vcache);
-      parent->clender->end->setBackTrace(parent->backLine, &parent->matchstart);
-      colorize(parent->clender->end.get(), parent->clender->lowContentPriority);
+      colorize(parent->clender->end.get(), parent->clender->lowContentPriority, &parent->backLine, &parent->matchstart);
       vtlist->clear();
     } else {
-      colorize(nullptr, false);
+      colorize(nullptr, false, nullptr, nullptr);
     }
 
     if (updateCache) {
@@ -116,21 +117,205 @@ int TextParser::Impl::parse(int from, int num, TextParseMode mode)
   return endLine;
 }
 
+int TextParser::Impl::parseParallel(int from, int num, unsigned int threads)
+{
+  if (threads == 0) {
+    threads = std::max(1u, std::thread::hardware_concurrency());
+  }
+  int chunk_lines = std::clamp(num / static_cast<int>(threads * PARALLEL_CHUNKS_PER_THREAD),
+                               PARALLEL_MIN_CHUNK_LINES, PARALLEL_MAX_CHUNK_LINES);
+  if (threads < 2 || num < chunk_lines * 2) {
+    return parse(from, num, TextParseMode::TPM_CACHE_OFF);
+  }
+  if (!regionHandler || !lineSource || !baseScheme) {
+    return from;
+  }
+  CTRACE(spdlog::trace("[TextParserImpl] parseParallel from={0}, num={1}, threads={2}", from, num, threads));
+  breakParsing = false;
+
+  std::vector<ParseChunk> chunks((num + chunk_lines - 1) / chunk_lines);
+  for (size_t idx = 0; idx < chunks.size(); idx++) {
+    chunks[idx].sline = from + static_cast<int>(idx) * chunk_lines;
+    chunks[idx].eline = std::min(from + num, chunks[idx].sline + chunk_lines);
+  }
+  // lines, which start in the base scheme in the chunks parse, one flag per line for the threads;
+  // chunk starts are marked before the threads start, each other line is marked by its chunk only
+  std::unique_ptr<std::atomic<char>[]> base_lines(new std::atomic<char>[num + 1]);
+  for (int i = 0; i <= num; i++) {
+    base_lines[i].store(0, std::memory_order_relaxed);
+  }
+  for (const auto& chunk : chunks) {
+    base_lines[chunk.sline - from].store(1, std::memory_order_relaxed);
+  }
+
+  std::mutex chunks_mutex;
+  std::condition_variable chunk_ready;
+  size_t next_chunk = 0;
+  // line, up to which the text is given to the region handler or is parsed again;
+  // the chunks are parsed not far ahead of it, not to keep the events of the whole text
+  std::atomic<int> replay_line {from};
+  int ahead_lines = chunk_lines * static_cast<int>(threads * PARALLEL_CHUNKS_AHEAD);
+  auto worker = [&]() {
+    Impl chunk_parser;
+    chunk_parser.baseScheme = baseScheme;
+    chunk_parser.lineSource = lineSource;
+    chunk_parser.maxBlockSize = maxBlockSize;
+    chunk_parser.regexpContext.setStepLimit(regexpContext.getStepLimit());
+    chunk_parser.baseLines = base_lines.get();
+    chunk_parser.linesFrom = from;
+    // the break of this parse stops the chunks in progress too
+    chunk_parser.breakFlag = &breakParsing;
+    std::unique_lock<std::mutex> lock(chunks_mutex);
+    while (next_chunk < chunks.size() && !breakParsing) {
+      size_t idx = next_chunk++;
+      // the line is moved by the reparse without notification, so it is checked periodically
+      while (!breakParsing && chunks[idx].sline >= replay_line + ahead_lines) {
+        chunk_ready.wait_for(lock, std::chrono::milliseconds(PARALLEL_WAIT_MS));
+      }
+      if (breakParsing) {
+        break;
+      }
+      lock.unlock();
+      chunk_parser.parseChunk(chunks[idx]);
+      lock.lock();
+      // the chunk, stopped by the break, is not complete
+      chunks[idx].ready = !breakParsing || chunks[idx].error;
+      chunk_ready.notify_all();
+    }
+    // the chunks, left by the break, are not parsed
+    chunk_ready.notify_all();
+  };
+  // returns false, if the parse is broken before the chunk is parsed
+  auto wait_chunk = [&](size_t idx) {
+    std::unique_lock<std::mutex> lock(chunks_mutex);
+    chunk_ready.wait(lock, [this, &chunks, idx] { return chunks[idx].ready || breakParsing; });
+    if (chunks[idx].error) {
+      std::rethrow_exception(chunks[idx].error);
+    }
+    return chunks[idx].ready;
+  };
+  auto set_replay_line = [&](int line) {
+    std::lock_guard<std::mutex> lock(chunks_mutex);
+    replay_line = line;
+    chunk_ready.notify_all();
+  };
+
+  lineSource->startJob(from);
+  regionHandler->startParsing(from);
+  std::vector<std::thread> workers;
+  for (unsigned int i = 0; i < threads; i++) {
+    workers.emplace_back(worker);
+  }
+
+  std::exception_ptr error;
+  // the parse from the line in the base scheme doesn't depend on the previous lines
+  int base_line = from;
+  endLine = from;
+  try {
+    for (size_t idx = 0; idx < chunks.size() && !breakParsing;) {
+      int sync_line = chunks[idx].sline;
+      if (sync_line != base_line) {
+        // chunk starts inside of a block, the text is parsed again up to the line, which starts
+        // in the base scheme in this parse and in the parse of its chunk; the chunks are parsed
+        // meanwhile, so the line can be in the chunk, which is not ready yet
+        CTRACE(spdlog::trace("[TextParserImpl] parseParallel: reparse from {0}", base_line));
+        ParseChunk reparse;
+        reparse.sline = base_line;
+        reparse.eline = from + num;
+        syncLines = base_lines.get();
+        linesFrom = from;
+        syncLine = sync_line;
+        parseProgress = &replay_line;
+        parseChunk(reparse);
+        syncLines = nullptr;
+        parseProgress = nullptr;
+        if (reparse.error) {
+          std::rethrow_exception(reparse.error);
+        }
+        if (breakParsing) {
+          break;
+        }
+        reparse.regions.replay(regionHandler, sync_line);
+        endLine = reparse.eline - 1;
+        if (reparse.eline == from + num) {
+          break;
+        }
+        // the rest of the chunk is parsed right
+        sync_line = reparse.eline;
+        idx = (sync_line - from) / chunk_lines;
+      }
+      if (!wait_chunk(idx)) {
+        break;
+      }
+      auto& chunk = chunks[idx];
+      chunk.regions.replay(regionHandler, sync_line);
+      chunk.regions.clear();
+      base_line = chunk.baseLine;
+      endLine = chunk.eline - 1;
+      set_replay_line(chunk.eline);
+      idx++;
+    }
+  } catch (...) {
+    error = std::current_exception();
+  }
+  // the rest of the chunks are not needed, the workers are stopped by the break
+  {
+    std::lock_guard<std::mutex> lock(chunks_mutex);
+    breakParsing = true;
+    chunk_ready.notify_all();
+  }
+  for (auto& thread : workers) {
+    thread.join();
+  }
+  if (error) {
+    std::rethrow_exception(error);
+  }
+  regionHandler->endParsing(endLine);
+  lineSource->endJob(endLine);
+  return endLine;
+}
+
+/**
+  Parses the lines of the chunk from the base scheme, the events are stored in the chunk.
+*/
+void TextParser::Impl::parseChunk(ParseChunk& chunk)
+{
+  RegionHandler* o_handler = regionHandler;
+  regionHandler = &chunk.regions;
+  gx = 0;
+  gy = chunk.sline;
+  gy2 = chunk.eline;
+  clearLine = -1;
+  invisibleSchemesFilled = false;
+  schemeStart = -1;
+  updateCache = false;
+  stackLevel = 0;
+  baseLine = chunk.sline;
+
+  vtlist = new VTList();
+  parent = cache;
+  forward = nullptr;
+  cache->scheme = baseScheme;
+  try {
+    colorize(nullptr, false, nullptr, nullptr);
+  } catch (...) {
+    chunk.error = std::current_exception();
+  }
+  delete vtlist;
+  vtlist = nullptr;
+  regionHandler = o_handler;
+
+  chunk.eline = gy;
+  chunk.baseLine = baseLine;
+}
+
 void TextParser::Impl::clearCache()
 {
-  ParseCache *tmp, *tmp2;
-  tmp = cache->next;
-  while (tmp) {
-    tmp2 = tmp->next;
-    delete tmp;
-    tmp = tmp2;
-  }
-  delete cache->children;
-  delete cache->backLine;
-  cache->backLine = nullptr;
+  // all entries of the tree are released at once
+  cachePool.releaseAll();
+  cache->reset();
   cache->sline = 0;
   cache->eline = 0x7FFFFFF;
-  cache->children = cache->parent = cache->next = nullptr;
 }
 
 void TextParser::Impl::breakParse()
@@ -290,9 +475,11 @@ int TextParser::Impl::searchRE(const SchemeImpl* cscheme, int no, int lowLen, in
   if (!cscheme) {
     return MATCH_NOTHING;
   }
-  int idx = 0;
-  for (auto const& schemeNode : cscheme->nodes) {
-    CTRACE(spdlog::trace("[TextParserImpl] searchRE: processing node:{0}/{1}, type:{2}", idx + 1, cscheme->nodes.size(),
+  // only nodes, which can match at the current symbol, are checked
+  auto candidates = cscheme->getCandidates(gx < str->length() ? (*str)[gx] : BAD_WCHAR);
+  for (const int* idx = candidates.first; idx != candidates.second; idx++) {
+    auto const& schemeNode = cscheme->nodes[*idx];
+    CTRACE(spdlog::trace("[TextParserImpl] searchRE: processing node:{0}/{1}, type:{2}", *idx + 1, cscheme->nodes.size(),
                          SchemeNode::schemeNodeTypeNames[static_cast<int>(schemeNode->type)]));
     switch (schemeNode->type) {
       case SchemeNode::SchemeNodeType::SNT_EMPTY:
@@ -324,7 +511,7 @@ int TextParser::Impl::searchRE(const SchemeImpl* cscheme, int no, int lowLen, in
         break;
 
       case SchemeNode::SchemeNodeType::SNT_RE:
-        if (!schemeNode->start->parse(str, gx, schemeNode->lowPriority ? lowLen : hiLen, &match, schemeStart)) {
+        if (!schemeNode->start->parse(str, gx, schemeNode->lowPriority ? lowLen : hiLen, &match, schemeStart, -1, &regexpContext)) {
           break;
         }
         CTRACE(spdlog::trace("[TextParserImpl] RE matched. gx={0}", gx));
@@ -346,7 +533,7 @@ int TextParser::Impl::searchRE(const SchemeImpl* cscheme, int no, int lowLen, in
         if (!schemeNode->scheme) {
           break;
         }
-        if (!schemeNode->start->parse(str, gx, schemeNode->lowPriority ? lowLen : hiLen, &match, schemeStart)) {
+        if (!schemeNode->start->parse(str, gx, schemeNode->lowPriority ? lowLen : hiLen, &match, schemeStart, -1, &regexpContext)) {
           break;
         }
 
@@ -358,32 +545,35 @@ int TextParser::Impl::searchRE(const SchemeImpl* cscheme, int no, int lowLen, in
           ssubst = schemeNode->scheme;
         }
 
-        auto* backLine = new UnicodeString(*str);
+        // end RE without \y \Y doesn't need the start line
+        const CRegExp* end_re = schemeNode->end.get();
+        bool backTrace = end_re && end_re->hasBackTrace();
+        UnicodeString* backLine = nullptr;
+        const SMatches* backMatch = &match;
         if (updateCache) {
           ResF = forward;
           ResP = parent;
-          if (forward) {
-            forward->next = new ParseCache;
-            forward->next->prev = forward;
-            OldCacheF = forward->next;
-            OldCacheP = parent ? parent : forward->parent;
-            parent = forward->next;
-            forward = nullptr;
-          } else {
-            forward = new ParseCache;
-            parent->children = forward;
-            OldCacheF = forward;
-            OldCacheP = parent;
-            parent = forward;
-            forward = nullptr;
-          }
+          // forward is the last child of the parent, new block follows it
+          OldCacheP = parent ? parent : forward->parent;
+          OldCacheF = cachePool.allocate();
+          OldCacheP->children.push_back(OldCacheF);
+          parent = OldCacheF;
+          forward = nullptr;
           OldCacheF->parent = OldCacheP;
           OldCacheF->sline = gy + 1;
           OldCacheF->eline = 0x7FFFFFFF;
           OldCacheF->scheme = ssubst;
-          OldCacheF->matchstart = match;
           OldCacheF->clender = schemeNode.get();
-          OldCacheF->backLine = backLine;
+          // cache keeps only the brackets, read by the end RE
+          if (backTrace) {
+            end_re->copyBackTrace(*str, match, OldCacheF->backLine, OldCacheF->matchstart);
+            backLine = &OldCacheF->backLine;
+            backMatch = &OldCacheF->matchstart;
+          }
+        } else if (backTrace) {
+          // line of the not cached block is shared with the buffer of the recursion level
+          backLine = &backLines[stackLevel];
+          *backLine = *str;
         }
 
         int ogy = gy;
@@ -391,18 +581,16 @@ int TextParser::Impl::searchRE(const SchemeImpl* cscheme, int no, int lowLen, in
 
         SchemeImpl* o_scheme = baseScheme;
         int o_schemeStart = schemeStart;
-        SMatches o_matchend = matchend;
-        SMatches* o_match;
-        UnicodeString* o_str;
-        schemeNode->end->getBackTrace((const UnicodeString**) &o_str, &o_match);
+        // only the used brackets are saved, parent's end is read up to its cMatch
+        SMatches o_matchend;
+        o_matchend.copyUsed(matchend);
 
         baseScheme = ssubst;
         schemeStart = gx;
-        schemeNode->end->setBackTrace(backLine, &match);
 
         enterScheme(no, &match, schemeNode.get());
 
-        colorize(schemeNode->end.get(), schemeNode->lowContentPriority);
+        colorize(end_re, schemeNode->lowContentPriority, backLine, backMatch);
 
         if (gy < gy2) {
           leaveScheme(gy, &matchend, schemeNode.get());
@@ -411,29 +599,22 @@ int TextParser::Impl::searchRE(const SchemeImpl* cscheme, int no, int lowLen, in
         /* (empty-block.test) Check if the consumed scheme is zero-length */
         zeroLength = (match.s[0] == matchend.e[0] && ogy == gy);
 
-        schemeNode->end->setBackTrace(o_str, o_match);
-        matchend = o_matchend;
+        matchend.copyUsed(o_matchend);
         schemeStart = o_schemeStart;
         baseScheme = o_scheme;
 
         if (updateCache) {
           if (ogy == gy) {
-            delete OldCacheF;
-            if (ResF) {
-              ResF->next = nullptr;
-            } else if (ResP) {
-              ResP->children = nullptr;
-            }
+            OldCacheP->children.pop_back();
+            cachePool.release(OldCacheF);
             forward = ResF;
             parent = ResP;
           } else {
             OldCacheF->eline = gy;  //-V522
-            OldCacheF->vcache = vtlist->store();
+            vtlist->store(OldCacheF->vcache);
             forward = OldCacheF;
             parent = OldCacheP;
           }
-        } else {
-          delete backLine;
         }
         if (ssubst != schemeNode->scheme) {
           vtlist->popvirt();
@@ -446,14 +627,48 @@ int TextParser::Impl::searchRE(const SchemeImpl* cscheme, int no, int lowLen, in
         return MATCH_SCHEME;
       }
     }
-    idx++;
   }
   return MATCH_NOTHING;
 }
 
-bool TextParser::Impl::colorize(CRegExp* root_end_re, bool lowContentPriority)
+/**
+  Adds ASCII symbols, at which the nodes of the scheme or of its inherited schemes can match.
+  Inherited schemes are virtualized in the same way, as in searchRE.
+*/
+void TextParser::Impl::addStartSymbols(const SchemeImpl* cscheme, uint32_t* mask)
+{
+  if (!cscheme) {
+    return;
+  }
+  for (size_t i = 0; i < std::size(cscheme->startMask); i++) {
+    mask[i] |= cscheme->startMask[i];
+  }
+  for (int idx : cscheme->inheritNodes) {
+    auto const& schemeNode = cscheme->nodes[idx];
+    if (!schemeNode->scheme) {
+      continue;
+    }
+    SchemeImpl* ssubst = vtlist->pushvirt(schemeNode->scheme);
+    if (!ssubst) {
+      bool b = vtlist->push(schemeNode.get());
+      addStartSymbols(schemeNode->scheme, mask);
+      if (b) {
+        vtlist->pop();
+      }
+    } else {
+      addStartSymbols(ssubst, mask);
+      vtlist->popvirt();
+    }
+  }
+}
+
+bool TextParser::Impl::colorize(const CRegExp* root_end_re, bool lowContentPriority, const UnicodeString* backStr,
+                                const SMatches* backTrace)
 {
   len = -1;
+  // ASCII symbols, which can start any node of baseScheme, filled on the first need
+  uint32_t startMask[4] = {};
+  bool startMaskFilled = false;
 
   /* Direct check for recursion level */
   if (stackLevel > MAX_RECURSION_LEVEL) {
@@ -472,6 +687,8 @@ bool TextParser::Impl::colorize(CRegExp* root_end_re, bool lowContentPriority)
         throw Exception("null String passed into the parser: " + UStr::to_unistr(gy));
       }
       regionHandler->clearLine(gy, str);
+      // lines without surrogates are matched by code units
+      regexpContext.setSurrogateFree(UStr::hasSurrogates(*str, 0, str->length()) ? nullptr : str);
     }
     // hack to include invisible regions in start of block
     // when parsing with cache information
@@ -488,7 +705,7 @@ bool TextParser::Impl::colorize(CRegExp* root_end_re, bool lowContentPriority)
     // searches for the end of parent block
     int res = 0;
     if (root_end_re) {
-      res = root_end_re->parse(str, gx, len, &matchend, schemeStart);
+      res = root_end_re->parse(str, gx, len, &matchend, schemeStart, -1, backStr, backTrace, &regexpContext);
     }
     if (!res) {
       matchend.s[0] = matchend.e[0] = gx + maxBlockSize > len ? len : gx + maxBlockSize;
@@ -505,7 +722,7 @@ bool TextParser::Impl::colorize(CRegExp* root_end_re, bool lowContentPriority)
 
     int ret = LINE_NEXT;
     for (; gx <= matchend.s[0];) {  //    '<' or '<=' ???
-      if (breakParsing) {
+      if (*breakFlag) {
         gy = gy2;
         break;
       }
@@ -534,6 +751,19 @@ bool TextParser::Impl::colorize(CRegExp* root_end_re, bool lowContentPriority)
       }
       if (re_result == MATCH_NOTHING) {
         gx++;
+        // jumps over the symbols, at which nothing can match, up to the end of block
+        if (!startMaskFilled) {
+          startMaskFilled = true;
+          addStartSymbols(baseScheme, startMask);
+          // picked region can be set later by leaveScheme, so 'C' always stops the jump
+          startMask['C' >> 5] |= 1u << ('C' & 31);
+        }
+        for (; gx < matchend.s[0]; gx++) {
+          UChar c = (*str)[gx];
+          if (c >= 0x80 || (startMask[c >> 5] & (1u << (c & 31)))) {
+            break;
+          }
+        }
       }
     }
     if (ret == LINE_REPARSE) {
@@ -548,6 +778,18 @@ bool TextParser::Impl::colorize(CRegExp* root_end_re, bool lowContentPriority)
     len = -1;
     gy++;
     gx = 0;
+    if (parseProgress) {
+      parseProgress->store(gy, std::memory_order_relaxed);
+    }
+    if (!root_end_re && stackLevel == 1) {
+      baseLine = gy;
+      if (baseLines) {
+        baseLines[gy - linesFrom].store(1, std::memory_order_relaxed);
+      }
+      if (syncLines && gy >= syncLine && syncLines[gy - linesFrom].load(std::memory_order_relaxed)) {
+        gy2 = gy;
+      }
+    }
   }
   stackLevel--;
   return true;
@@ -557,3 +799,13 @@ void TextParser::Impl::setMaxBlockSize(int max_block_size)
 {
   maxBlockSize = max_block_size;
 }
+
+void TextParser::Impl::setRegExpStepLimit(int step_limit)
+{
+  regexpContext.setStepLimit(step_limit);
+}
+
+void TextParser::Impl::setRegExpProfile(RegExpProfile* profile)
+{
+  regexpContext.setProfile(profile);
+}
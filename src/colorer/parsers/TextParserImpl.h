@@ -1,10 +1,21 @@
 #ifndef _COLORER_TEXTPARSERIMPL_H_
 #define _COLORER_TEXTPARSERIMPL_H_
 
+#include <atomic>
+#include <exception>
 #include "colorer/TextParser.h"
 #include "colorer/parsers/TextParserHelpers.h"
 
 #define MAX_RECURSION_LEVEL 100
+#define DEFAULT_REGEXP_STEP_LIMIT 10000000
+// parallel parse splits the text into chunks of at least this number of lines
+#define PARALLEL_MIN_CHUNK_LINES 500
+#define PARALLEL_MAX_CHUNK_LINES 8000
+#define PARALLEL_CHUNKS_PER_THREAD 4
+// chunks, which are parsed ahead of the line given to the region handler, per thread
+#define PARALLEL_CHUNKS_AHEAD 2
+// period of the check of the reparse progress by the waiting threads
+#define PARALLEL_WAIT_MS 1
 
 /**
  * Implementation of TextParser interface.
@@ -23,11 +34,28 @@ class TextParser::Impl
   void setLineSource(LineSource* lh);
   void setRegionHandler(RegionHandler* rh);
   int parse(int from, int num, TextParseMode mode);
+  int parseParallel(int from, int num, unsigned int threads);
   void breakParse();
   void clearCache();
   void setMaxBlockSize(int max_block_size);
+  void setRegExpStepLimit(int step_limit);
+  void setRegExpProfile(RegExpProfile* profile);
 
  private:
+  /** Lines of the text, parsed by one thread of the parallel parse.
+   */
+  struct ParseChunk
+  {
+    int sline = 0;
+    int eline = 0;
+    // last line of the chunk (up to eline), which starts in the base scheme
+    int baseLine = 0;
+    RegionBuffer regions;
+    std::exception_ptr error;
+    // guarded by the mutex of the parallel parse
+    bool ready = false;
+  };
+
   UnicodeString* str = nullptr;
   int stackLevel = 0;
   int gy = 0;
@@ -38,18 +66,38 @@ class TextParser::Impl
   int endLine = 0;
   int schemeStart = -1;
   SchemeImpl* baseScheme = nullptr;
+  // last parsed line, which starts in the base scheme
+  int baseLine = 0;
+  // flags of the lines, which start in the base scheme, indexed from linesFrom:
+  // marked by the chunks parse of the parallel parse
+  std::atomic<char>* baseLines = nullptr;
+  // parse stops at the marked line after syncLine, which starts in the base scheme;
+  // lines are marked by other threads during the parse
+  const std::atomic<char>* syncLines = nullptr;
+  int linesFrom = 0;
+  int syncLine = 0;
+  // if set, the current line is stored here for other threads
+  std::atomic<int>* parseProgress = nullptr;
 
-  bool breakParsing = false;
+  // set by breakParse() from other thread
+  std::atomic<bool> breakParsing {false};
+  // parse stops, when the flag is set: own breakParsing, or one of the parallel parse
+  const std::atomic<bool>* breakFlag = &breakParsing;
   bool invisibleSchemesFilled = false;
   bool updateCache = false;
   const Region* picked = nullptr;
 
+  ParseCachePool cachePool;
   ParseCache* cache = nullptr;
   ParseCache* parent = nullptr;
   ParseCache* forward = nullptr;
 
   SMatches matchend = {};
+  // block start lines for the end REs with \y \Y, when the cache is not updated, one per recursion level
+  std::vector<UnicodeString> backLines;
   VTList* vtlist = nullptr;
+  // backtracking stack for all regexps of this parser
+  RegExpContext regexpContext;
 
   LineSource* lineSource = nullptr;
   RegionHandler* regionHandler = nullptr;
@@ -57,6 +105,7 @@ class TextParser::Impl
   // maximum block size of regexp in string line
   int maxBlockSize = 1000;
 
+  void parseChunk(ParseChunk& chunk);
   void fillInvisibleSchemes(ParseCache* cache);
   void addRegion(int lno, int sx, int ex, const Region* region);
   void enterScheme(int lno, int sx, int ex, const Region* region);
@@ -66,7 +115,8 @@ class TextParser::Impl
 
   int searchKW(const SchemeNode* node, int no, int lowLen, int hiLen);
   int searchRE(const SchemeImpl* cscheme, int no, int lowLen, int hiLen);
-  bool colorize(CRegExp* root_end_re, bool lowContentPriority);
+  void addStartSymbols(const SchemeImpl* cscheme, uint32_t* mask);
+  bool colorize(const CRegExp* root_end_re, bool lowContentPriority, const UnicodeString* backStr, const SMatches* backTrace);
 };
 
 #endif
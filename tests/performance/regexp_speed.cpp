@@ -0,0 +1,322 @@
+#include <colorer/Exception.h>
+#include <colorer/cregexp/cregexp.h>
+#include <colorer/viewer/TextLinesStore.h>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <cwchar>
+#include <fstream>
+#include <memory>
+#include <string>
+#include <vector>
+using namespace std::chrono;
+
+/*
+ *  speed test of CRegExp engines: the regexps are checked at all positions
+ *  of the lines, as the parser checks the start regexps of the scheme nodes
+ */
+
+// start regexps of the scheme nodes from the base HRC schemes
+static const char* default_patterns[] = {
+    // c.hrc, cpp.hrc
+    R"(/\b(if|else|while|for|do|switch|case|default|break|continue|return|goto)\b/)",
+    R"(/\b(int|char|short|long|float|double|void|signed|unsigned|bool|auto)\b/)",
+    R"(/^\s*#\s*(include|define|undef|if|ifdef|ifndef|else|elif|endif|pragma)\b/)",
+    R"(/(\/\*)/)",
+    R"(/(\*\/)/)",
+    R"(/\/\/.*$/)",
+    R"(/\b(0[xX][\da-fA-F]+[uUlL]*)\b/)",
+    R"(/\b((\d+\.?\d*|\.\d+)([eE][\-+]?\d+)?[fFlL]?)\b/)",
+    R"(/(")((\\.|[^\\"])*?)(")/)",
+    R"(/'(\\.|[^\\'])'/)",
+    R"(/\b([\w_]+)\s*(\()/)",
+    R"(/[\(\)\{\}\[\];,]/)",
+    R"(/(\+\+|--|->|<<=?|>>=?|[!=<>]=|&&|\|\||[+\-*\/%&|\^~!=<>?:])/)",
+    // java.hrc
+    R"(/\b(public|private|protected|static|final|abstract|synchronized|native)\b/)",
+    R"(/@[\w\.]+/)",
+    // xml.hrc, html.hrc
+    R"(/(<)([\w\-\.:]+)/)",
+    R"(/(<\/)([\w\-\.:]+)\s*(>)/)",
+    R"(/\s*([\w\-\.:]+)\s*(=)\s*(["'])/)",
+    R"(/(&)(#\d+|#x[\da-fA-F]+|\w+)(;)/)",
+    R"(/(<!--)/)",
+    // perl.hrc, shell.hrc
+    R"(/\$[\w:]+|\$\{[^}]*\}/)",
+    R"(/^\s*(sub)\s+(\w+)/)",
+    R"(/(\bq[qwrx]?\s*)([\(\{\[<\/])/)",
+    // sql.hrc, case insensitive keywords
+    R"(/\b(select|from|where|group|order|by|insert|update|delete|join)\b/i)",
+    // generic
+    R"(/\b[A-Z_][A-Z_0-9]+\b/)",
+    R"(/\s+$/)",
+    R"(/[^\s\w]+/)",
+};
+
+static const char* default_lines[] = {
+    "#include <stdio.h>",
+    "  for (int i = 0; i < count; i++) { total += values[i] * 2.5e-3f; } // sum",
+    "  if (ptr->next != nullptr && (flags & 0x1Fu)) return compute(x, \"str\\\"ing\", 'c');",
+    "  /* comment with MAX_SIZE and some words */ static const long MAX_SIZE = 1024L;",
+    "  @Override public synchronized void run() { list.add(new Item(name, 42)); }",
+    "<item id=\"main\" class='menu entry'>text &amp; more &#169; <b>bold</b></item>",
+    "  <!-- xml comment -->  <ns:tag attr=\"value\"/>",
+    "my $value = qw(alpha beta gamma); print \"${name}: $hash{key}\\n\" if $debug;",
+    "SELECT name, count(*) FROM users WHERE id > 10 GROUP BY name ORDER BY name;",
+    "    result = (a << 2) | (b >> 3) ^ ~c;   ",
+};
+
+struct Pattern
+{
+  UnicodeString text;
+  std::unique_ptr<CRegExp> re;
+};
+
+struct EngineRun
+{
+  const char* name;
+  EEngine engine;
+  std::vector<double> seconds;
+  RegExpProfile profile;
+};
+
+int loops = 1;
+bool moves = false;
+bool compare = true;
+EEngine single_engine = EEngine::Program;
+const char* patternsFile = nullptr;
+const char* testFile = nullptr;
+
+void printError()
+{
+  fwprintf(stderr,
+           L"\nUsage: regexp_speed_test (parameters)\n"
+           L" Parameters:\n"
+           L"  -c<n>      Number of test runs\n"
+           L"  -p<path>   File of the regexps, one /re/ per line\n"
+           L"  -f<path>   Test file\n"
+           L"  -e<name>   Runs only the engine <name>: tree, program\n"
+           L"  -m         Searches with position moves, instead of the check at each position\n\n");
+}
+
+int init(int argc, char* argv[])
+{
+  for (int i = 1; i < argc; i++) {
+    if (argv[i][0] != '-') {
+      return -1;
+    }
+    if (argv[i][1] == 'c') {
+      if (argv[i][2]) {
+        loops = atoi(argv[i] + 2);
+      }
+      if (!loops)
+        loops = 1;
+      continue;
+    }
+    if (argv[i][1] == 'm') {
+      moves = true;
+      continue;
+    }
+    if (argv[i][1] == 'e' && argv[i][2]) {
+      compare = false;
+      if (strcmp(argv[i] + 2, "tree") == 0)
+        single_engine = EEngine::Tree;
+      else if (strcmp(argv[i] + 2, "program") == 0)
+        single_engine = EEngine::Program;
+      else
+        return -1;
+      continue;
+    }
+    if (argv[i][1] == 'p' && (i + 1 < argc || argv[i][2])) {
+      if (argv[i][2]) {
+        patternsFile = argv[i] + 2;
+      } else {
+        patternsFile = argv[i + 1];
+        i++;
+      }
+      continue;
+    }
+    if (argv[i][1] == 'f' && (i + 1 < argc || argv[i][2])) {
+      if (argv[i][2]) {
+        testFile = argv[i] + 2;
+      } else {
+        testFile = argv[i + 1];
+        i++;
+      }
+      continue;
+    }
+    if (argv[i][1]) {
+      fprintf(stderr, "WARNING: unknown option '-%s'\n", argv[i] + 1);
+      return -1;
+    }
+  }
+  return 1;
+}
+
+std::vector<Pattern> loadPatterns()
+{
+  std::vector<std::string> texts;
+  if (patternsFile) {
+    std::ifstream in(patternsFile);
+    if (!in) {
+      throw Exception(UnicodeString("can't open file ") + UnicodeString(patternsFile));
+    }
+    std::string line;
+    while (std::getline(in, line)) {
+      if (!line.empty() && line.back() == '\r')
+        line.pop_back();
+      if (!line.empty())
+        texts.push_back(line);
+    }
+  }
+  else {
+    texts.assign(std::begin(default_patterns), std::end(default_patterns));
+  }
+  std::vector<Pattern> patterns;
+  for (const auto& text : texts) {
+    Pattern pattern;
+    pattern.text = UnicodeString::fromUTF8(text);
+    pattern.re = std::make_unique<CRegExp>(&pattern.text);
+    if (!pattern.re->isOk()) {
+      fprintf(stderr, "skipped, bad regexp: %s\n", text.c_str());
+      continue;
+    }
+    pattern.re->setPositionMoves(moves);
+    patterns.push_back(std::move(pattern));
+  }
+  return patterns;
+}
+
+std::vector<UnicodeString> loadLines()
+{
+  std::vector<UnicodeString> lines;
+  if (testFile) {
+    TextLinesStore textLinesStore;
+    UnicodeString path(testFile);
+    textLinesStore.loadFile(&path, true);
+    for (size_t i = 0; i < textLinesStore.getLineCount(); i++) {
+      lines.push_back(*textLinesStore.getLine(i));
+    }
+  }
+  else {
+    for (const char* line : default_lines) {
+      lines.emplace_back(line);
+    }
+  }
+  return lines;
+}
+
+/*
+ *  runs the regexp over all lines, returns count of the matches
+ */
+long runPattern(const CRegExp& re, const std::vector<UnicodeString>& lines, RegExpContext& context)
+{
+  SMatches match;
+  long found = 0;
+  for (const auto& line : lines) {
+    int len = line.length();
+    for (int pos = 0; pos <= len; pos++) {
+      if (re.parse(&line, pos, len, &match, 0, -1, &context)) {
+        found++;
+        // moving search continues after the match
+        if (moves)
+          pos = match.e[0] > match.s[0] ? match.e[0] - 1 : match.s[0];
+      }
+      else if (moves)
+        break;
+    }
+  }
+  return found;
+}
+
+void runEngine(EngineRun& run, std::vector<Pattern>& patterns, const std::vector<UnicodeString>& lines)
+{
+  RegExpContext context;
+  run.seconds.assign(patterns.size(), 0);
+  for (size_t idx = 0; idx < patterns.size(); idx++) {
+    CRegExp& re = *patterns[idx].re;
+    re.setEngine(run.engine);
+    // warm up pass fills DFA cache and the stacks
+    runPattern(re, lines, context);
+    // best run is taken, the short runs are easily distorted by the system
+    for (int i = 0; i < loops; i++) {
+      high_resolution_clock::time_point t1 = high_resolution_clock::now();
+      runPattern(re, lines, context);
+      high_resolution_clock::time_point t2 = high_resolution_clock::now();
+      double seconds = duration_cast<duration<double>>(t2 - t1).count();
+      if (i == 0 || seconds < run.seconds[idx])
+        run.seconds[idx] = seconds;
+    }
+    // profiled pass is separate, timer calls are not counted
+    context.setProfile(&run.profile);
+    runPattern(re, lines, context);
+    context.setProfile(nullptr);
+  }
+}
+
+void printReport(const EngineRun& run, const std::vector<Pattern>& patterns)
+{
+  printf("engine: %s\n", run.name);
+  printf("%10s %10s %12s %12s %10s %6s  %s\n", "calls", "matches", "ns/call", "matches/s",
+         "steps/call", "depth", "regexp");
+  double all_time = 0;
+  for (size_t idx = 0; idx < patterns.size(); idx++) {
+    const SRegExpStat& stat = run.profile.stats.at(patterns[idx].re.get());
+    double seconds = run.seconds[idx];
+    all_time += seconds;
+    std::string text;
+    patterns[idx].text.toUTF8String(text);
+    printf("%10u %10u %12.1f %12.0f %10.1f %6d  %s\n", stat.calls, stat.matches,
+           stat.calls ? seconds * 1e9 / stat.calls : 0, seconds ? stat.matches / seconds : 0,
+           stat.calls ? double(stat.steps) / stat.calls : 0, stat.depth, text.c_str());
+  }
+  printf("the best time of %d tests %g sec.\n\n", loops, all_time);
+}
+
+void printComparison(const EngineRun& base, const EngineRun& run, const std::vector<Pattern>& patterns)
+{
+  printf("%s / %s time:\n", run.name, base.name);
+  double base_time = 0;
+  double run_time = 0;
+  for (size_t idx = 0; idx < patterns.size(); idx++) {
+    base_time += base.seconds[idx];
+    run_time += run.seconds[idx];
+    std::string text;
+    patterns[idx].text.toUTF8String(text);
+    const SRegExpStat& base_stat = base.profile.stats.at(patterns[idx].re.get());
+    const SRegExpStat& stat = run.profile.stats.at(patterns[idx].re.get());
+    // engines must agree, otherwise the times are not comparable
+    const char* mark = base_stat.matches != stat.matches ? "  MISMATCH" : "";
+    printf("%8.2f  %s%s\n", base.seconds[idx] ? run.seconds[idx] / base.seconds[idx] : 0,
+           text.c_str(), mark);
+  }
+  printf("%8.2f  total\n", base_time ? run_time / base_time : 0);
+}
+
+int main(int argc, char* argv[])
+{
+  if (init(argc, argv) == -1) {
+    printError();
+    return 1;
+  }
+
+  try {
+    auto patterns = loadPatterns();
+    auto lines = loadLines();
+    std::vector<EngineRun> runs;
+    if (compare || single_engine == EEngine::Tree)
+      runs.push_back(EngineRun {"tree", EEngine::Tree, {}, {}});
+    if (compare || single_engine == EEngine::Program)
+      runs.push_back(EngineRun {"program", EEngine::Program, {}, {}});
+    for (auto& run : runs) {
+      runEngine(run, patterns, lines);
+      printReport(run, patterns);
+    }
+    if (runs.size() > 1)
+      printComparison(runs[0], runs[1], patterns);
+  } catch (Exception& e) {
+    fprintf(stderr, "%s\n", e.what());
+    return -1;
+  }
+  return 0;
+}
@@ -2,7 +2,7 @@
 #include <memory>
 #include "tests.h"
 
-enum JobType { JT_NOTHING, JT_TEST1, JT_TEST2, JT_TEST3, JT_TEST4, JT_TEST5 };
+enum JobType { JT_NOTHING, JT_TEST1, JT_TEST2, JT_TEST3, JT_TEST4, JT_TEST5, JT_TEST6, JT_TEST7, JT_TEST8, JT_TEST9 };
 
 int loops = 1;
 JobType job = JT_NOTHING;
@@ -24,7 +24,11 @@ void printError()
            L"   2         TestParserFactoryHrcLibrary\n"
            L"   3         TestParserFactoryStyledMapper\n"
            L"   4         TestParserFactoryLoadAllHRCScheme\n"
-           L"   5         TestColoringFile\n");
+           L"   5         TestColoringFile\n"
+           L"   6         TestCharProperties\n"
+           L"   7         TestColoringBatch\n"
+           L"   8         TestColoringParallel\n"
+           L"   9         TestCacheJumps\n");
 }
 
 int init(int argc, char* argv[])
@@ -101,6 +105,18 @@ int main(int argc, char* argv[])
       case JT_TEST5:
         TestColoringFile(loops, catalogPath, testFile);
         break;
+      case JT_TEST6:
+        TestCharProperties(loops, testFile);
+        break;
+      case JT_TEST7:
+        TestColoringBatch(loops, catalogPath, testFile);
+        break;
+      case JT_TEST8:
+        TestColoringParallel(loops, catalogPath, testFile);
+        break;
+      case JT_TEST9:
+        TestCacheJumps(loops, catalogPath, testFile);
+        break;
     }
   } catch (Exception& e) {
     fprintf(stderr, "%s\n", e.what());
@@ -1,5 +1,10 @@
 #include "tests.h"
+#include <colorer/common/UStr.h>
+#include <unicode/uchar.h>
+#include <atomic>
 #include <iostream>
+#include <random>
+#include <thread>
 using namespace std;
 using namespace std::chrono;
 
@@ -113,27 +118,6 @@ void TestParserFactoryLoadAllHRCScheme(int count, UnicodeString* catalogPath)
   cout << "the average time for " << count << " tests " << all_time / count << " sec." << endl;
 }
 
-FileType* selectType(HrcLibrary* hrcLibrary, LineSource* lineSource, UnicodeString* testFile)
-{
-  FileType* type;
-
-  UnicodeString textStart;
-  int totalLength = 0;
-  for (int i = 0; i < 4; i++) {
-    UnicodeString* iLine = lineSource->getLine(i);
-    if (iLine == nullptr)
-      break;
-    textStart.append(*iLine);
-    textStart.append(UnicodeString("\n"));
-    totalLength += iLine->length();
-    if (totalLength > 500)
-      break;
-  }
-  type = hrcLibrary->chooseFileType(testFile, &textStart, 0);
-
-  return type;
-}
-
 /*
  *  speed test coloring file
  */
@@ -152,7 +136,7 @@ void TestColoringFile(int count, UnicodeString* catalogPath, UnicodeString* test
     // HRD RegionMapper linking
     auto console = UnicodeString("console");
     baseEditor.setRegionMapper(&console, nullptr);
-    FileType* type = selectType(&parserFactoryLocal.getHrcLibrary(), &textLinesStore, testFile);
+    FileType* type = parserFactoryLocal.getHrcLibrary().chooseFileTypeOf(testFile, &textLinesStore);
     type->getBaseScheme();
     baseEditor.setFileType(type);
 
@@ -172,4 +156,308 @@ void TestColoringFile(int count, UnicodeString* catalogPath, UnicodeString* test
     }
   }
   cout << "the average time for " << count << " tests " << all_time / count << " sec." << endl;
-}
\ No newline at end of file
+}
+
+/*
+ *  counts the regions of the parsed file
+ */
+class CountingRegionHandler : public RegionHandler
+{
+ public:
+  explicit CountingRegionHandler(std::atomic<size_t>& total) : total(total) {}
+  ~CountingRegionHandler() override { total += count; }
+
+  void addRegion(size_t /*lno*/, UnicodeString* /*line*/, int /*sx*/, int /*ex*/,
+                 const Region* /*region*/) override
+  {
+    count++;
+  }
+  void enterScheme(size_t /*lno*/, UnicodeString* /*line*/, int /*sx*/, int /*ex*/,
+                   const Region* /*region*/, const Scheme* /*scheme*/) override
+  {
+    count++;
+  }
+  void leaveScheme(size_t /*lno*/, UnicodeString* /*line*/, int /*sx*/, int /*ex*/,
+                   const Region* /*region*/, const Scheme* /*scheme*/) override
+  {
+    count++;
+  }
+
+ private:
+  std::atomic<size_t>& total;
+  size_t count = 0;
+};
+
+/*
+ *  speed test coloring of the batch of files by several threads,
+ *  the batch is the test file repeated for each thread
+ */
+void TestColoringBatch(int count, UnicodeString* catalogPath, UnicodeString* testFile)
+{
+  cout << "TestColoringBatch" << endl;
+  ParserFactory parserFactoryLocal;
+  parserFactoryLocal.loadCatalog(catalogPath);
+  parserFactoryLocal.getHrcLibrary().freeze();
+
+  unsigned int max_threads = std::max(1u, std::thread::hardware_concurrency());
+  std::vector<UnicodeString> files(max_threads * 8, *testFile);
+  double base_time = 0;
+  for (unsigned int threads = 1;; threads *= 2) {
+    if (threads > max_threads)
+      threads = max_threads;
+    double all_time = 0;
+    std::atomic<size_t> regions {0};
+    for (int i = 0; i <= count; i++) {
+      regions = 0;
+      high_resolution_clock::time_point t1 = high_resolution_clock::now();
+      parserFactoryLocal.colorizeBatch(files, threads, [&regions](size_t /*idx*/) {
+        return std::make_unique<CountingRegionHandler>(regions);
+      });
+      high_resolution_clock::time_point t2 = high_resolution_clock::now();
+      if (i) {
+        all_time += duration_cast<duration<double>>(t2 - t1).count();
+      }
+    }
+    all_time /= count;
+    if (threads == 1)
+      base_time = all_time;
+    cout << "threads: " << threads << ", files: " << files.size() << ", regions: " << regions
+         << ", average time: " << all_time << " sec., speedup: " << base_time / all_time << endl;
+    if (threads == max_threads)
+      break;
+  }
+}
+
+/*
+ *  order dependent digest of the parse results
+ */
+class DigestRegionHandler : public RegionHandler
+{
+ public:
+  void clearLine(size_t lno, UnicodeString* /*line*/) override { add(1, lno, 0, 0, nullptr); }
+  void addRegion(size_t lno, UnicodeString* /*line*/, int sx, int ex, const Region* region) override
+  {
+    add(2, lno, sx, ex, region);
+  }
+  void enterScheme(size_t lno, UnicodeString* /*line*/, int sx, int ex, const Region* region,
+                   const Scheme* /*scheme*/) override
+  {
+    add(3, lno, sx, ex, region);
+  }
+  void leaveScheme(size_t lno, UnicodeString* /*line*/, int sx, int ex, const Region* region,
+                   const Scheme* /*scheme*/) override
+  {
+    add(4, lno, sx, ex, region);
+  }
+
+  size_t digest = 0;
+  size_t count = 0;
+
+ private:
+  void add(size_t type, size_t lno, int sx, int ex, const Region* region)
+  {
+    size_t id = region ? region->getID() : 0;
+    for (size_t value : {type, lno, static_cast<size_t>(sx), static_cast<size_t>(ex), id}) {
+      digest = digest * 1099511628211u ^ value;
+    }
+    count++;
+  }
+};
+
+/*
+ *  speed test parallel parse of the file, compared to the sequential parse
+ */
+void TestColoringParallel(int count, UnicodeString* catalogPath, UnicodeString* testFile)
+{
+  cout << "TestColoringParallel" << endl;
+  ParserFactory parserFactoryLocal;
+  parserFactoryLocal.loadCatalog(catalogPath);
+  TextLinesStore textLinesStore;
+  textLinesStore.loadFile(testFile, false);
+  FileType* type = parserFactoryLocal.getHrcLibrary().chooseFileTypeOf(testFile, &textLinesStore);
+  type->getBaseScheme();
+  auto textParser = parserFactoryLocal.createTextParser();
+  textParser->setFileType(type);
+  textParser->setLineSource(&textLinesStore);
+  int lines = static_cast<int>(textLinesStore.getLineCount());
+
+  unsigned int max_threads = std::max(1u, std::thread::hardware_concurrency());
+  double base_time = 0;
+  size_t base_digest = 0;
+  // 0 threads - sequential parse
+  for (unsigned int threads = 0;; threads = threads ? threads * 2 : 1) {
+    if (threads > max_threads)
+      threads = max_threads;
+    double all_time = 0;
+    DigestRegionHandler handler;
+    textParser->setRegionHandler(&handler);
+    for (int i = 0; i <= count; i++) {
+      handler.digest = 0;
+      handler.count = 0;
+      high_resolution_clock::time_point t1 = high_resolution_clock::now();
+      if (threads)
+        textParser->parseParallel(0, lines, threads);
+      else
+        textParser->parse(0, lines, TextParser::TextParseMode::TPM_CACHE_OFF);
+      high_resolution_clock::time_point t2 = high_resolution_clock::now();
+      if (i) {
+        all_time += duration_cast<duration<double>>(t2 - t1).count();
+      }
+    }
+    textParser->setRegionHandler(nullptr);
+    all_time /= count;
+    if (threads == 0) {
+      base_time = all_time;
+      base_digest = handler.digest;
+      cout << "sequential, lines: " << lines << ", regions: " << handler.count
+           << ", average time: " << all_time << " sec." << endl;
+      continue;
+    }
+    cout << "threads: " << threads << ", average time: " << all_time
+         << " sec., speedup: " << base_time / all_time
+         << (handler.digest != base_digest ? ", RESULTS DIFFER" : "") << endl;
+    if (threads == max_threads)
+      break;
+  }
+}
+
+// lines of the text in the cache jumps test
+#define JUMPS_TEST_LINES 200000
+// jumps and edits in one test run
+#define JUMPS_PER_RUN 1000
+// visible lines of the editor window
+#define JUMPS_WINDOW_SIZE 50
+
+/*
+ *  lines of the file, repeated up to the required count
+ */
+class RepeatedLinesSource : public LineSource
+{
+ public:
+  RepeatedLinesSource(TextLinesStore& store, size_t count) : store(store), count(count) {}
+
+  UnicodeString* getLine(size_t lno) override
+  {
+    if (lno >= count || store.getLineCount() == 0)
+      return nullptr;
+    return store.getLine(lno % store.getLineCount());
+  }
+
+ private:
+  TextLinesStore& store;
+  size_t count;
+};
+
+/*
+ *  speed test of the parse cache: editor jumps to the random lines
+ *  and revalidates the random lines of the parsed text
+ */
+void TestCacheJumps(int count, UnicodeString* catalogPath, UnicodeString* testFile)
+{
+  cout << "TestCacheJumps" << endl;
+  ParserFactory parserFactoryLocal;
+  parserFactoryLocal.loadCatalog(catalogPath);
+  TextLinesStore textLinesStore;
+  textLinesStore.loadFile(testFile, true);
+  RepeatedLinesSource lineSource(textLinesStore, JUMPS_TEST_LINES);
+  BaseEditor baseEditor(&parserFactoryLocal, &lineSource);
+  auto console = UnicodeString("console");
+  baseEditor.setRegionMapper(&console, nullptr);
+  FileType* type = parserFactoryLocal.getHrcLibrary().chooseFileTypeOf(testFile, &lineSource);
+  type->getBaseScheme();
+  baseEditor.setFileType(type);
+
+  high_resolution_clock::time_point t1 = high_resolution_clock::now();
+  baseEditor.modifyLineEvent(0);
+  baseEditor.lineCountEvent(JUMPS_TEST_LINES);
+  baseEditor.visibleTextEvent(0, JUMPS_WINDOW_SIZE);
+  baseEditor.validate(-1, false);
+  high_resolution_clock::time_point t2 = high_resolution_clock::now();
+  cout << "lines: " << JUMPS_TEST_LINES
+       << ", full parse time: " << duration_cast<duration<double>>(t2 - t1).count() << " sec."
+       << endl;
+
+  // the same lines in each run
+  std::mt19937 random_lines(1);
+  double jumps_time = 0;
+  double edits_time = 0;
+  for (int i = 0; i < count; i++) {
+    t1 = high_resolution_clock::now();
+    for (int j = 0; j < JUMPS_PER_RUN; j++) {
+      int line = static_cast<int>(random_lines() % JUMPS_TEST_LINES);
+      baseEditor.visibleTextEvent(line, JUMPS_WINDOW_SIZE);
+      baseEditor.validate(line, true);
+    }
+    t2 = high_resolution_clock::now();
+    jumps_time += duration_cast<duration<double>>(t2 - t1).count();
+
+    t1 = high_resolution_clock::now();
+    for (int j = 0; j < JUMPS_PER_RUN; j++) {
+      int line = static_cast<int>(random_lines() % JUMPS_TEST_LINES);
+      baseEditor.modifyLineEvent(line);
+      baseEditor.visibleTextEvent(line, JUMPS_WINDOW_SIZE);
+      baseEditor.validate(line, true);
+    }
+    t2 = high_resolution_clock::now();
+    edits_time += duration_cast<duration<double>>(t2 - t1).count();
+  }
+  double jumps = static_cast<double>(count) * JUMPS_PER_RUN;
+  cout << "the average time of the jump " << jumps_time * 1e6 / jumps << " usec." << endl;
+  cout << "the average time of the edit " << edits_time * 1e6 / jumps << " usec." << endl;
+}
+
+/*
+ *  speed test of code unit classification, used by regexp metasymbols:
+ *  ICU property functions against the UStr properties table
+ */
+void TestCharProperties(int count, UnicodeString* testFile)
+{
+  cout << "TestCharProperties" << endl;
+  UnicodeString text;
+  if (testFile) {
+    TextLinesStore textLinesStore;
+    textLinesStore.loadFile(testFile, true);
+    for (size_t i = 0; i < textLinesStore.getLineCount(); i++) {
+      text.append(*textLinesStore.getLine(i));
+      text.append(UnicodeString("\n"));
+    }
+  }
+  else {
+    for (int i = 0; i < 20000; i++) {
+      text.append(UnicodeString("  for (int i_1 = 0; i_1 < count; i_1++) {\n"));
+      text.append(UnicodeString("    total += Value[i_1] * 2.5; // sum\n  }\n"));
+    }
+  }
+  int len = text.length();
+  const UChar* buf = text.getBuffer();
+
+  double icu_time = 0;
+  double table_time = 0;
+  long icu_sum = 0;
+  long table_sum = 0;
+  for (int i = 0; i <= count; i++) {
+    high_resolution_clock::time_point t1 = high_resolution_clock::now();
+    for (int pos = 0; pos < len; pos++) {
+      UChar c = buf[pos];
+      icu_sum += (u_isalpha(c) || u_isdigit(c) || c == '_') + u_isdigit(c) + u_isspace(c) +
+                 u_isupper(c) + u_islower(c);
+    }
+    high_resolution_clock::time_point t2 = high_resolution_clock::now();
+    for (int pos = 0; pos < len; pos++) {
+      UChar c = buf[pos];
+      table_sum += UStr::isWordSymbol(c) + UStr::isDigit(c) + UStr::isWhitespace(c) +
+                   UStr::isUpperCase(c) + UStr::isLowerCase(c);
+    }
+    high_resolution_clock::time_point t3 = high_resolution_clock::now();
+
+    if (i) {
+      icu_time += duration_cast<duration<double>>(t2 - t1).count();
+      table_time += duration_cast<duration<double>>(t3 - t2).count();
+    }
+  }
+  if (icu_sum != table_sum)
+    cout << "results differ: " << icu_sum << " " << table_sum << endl;
+  cout << "code units: " << len << endl;
+  cout << "the average time for " << count << " tests, ICU: " << icu_time / count
+       << " sec., table: " << table_time / count << " sec." << endl;
+}
@@ -6,4 +6,8 @@ void TestParserFactoryConstructor(int count, UnicodeString* catalogPath);
 void TestParserFactoryHrcLibrary(int count, UnicodeString* catalogPath);
 void TestParserFactoryStyledMapper(int count, UnicodeString* catalogPath);
 void TestParserFactoryLoadAllHRCScheme(int count, UnicodeString* catalogPath);
-void TestColoringFile(int count, UnicodeString* catalogPath, UnicodeString* testFile);
\ No newline at end of file
+void TestColoringFile(int count, UnicodeString* catalogPath, UnicodeString* testFile);
+void TestColoringBatch(int count, UnicodeString* catalogPath, UnicodeString* testFile);
+void TestColoringParallel(int count, UnicodeString* catalogPath, UnicodeString* testFile);
+void TestCacheJumps(int count, UnicodeString* catalogPath, UnicodeString* testFile);
+void TestCharProperties(int count, UnicodeString* testFile);
\ No newline at end of file
@@ -0,0 +1,643 @@
+// Matchers of the test_cregexp.cpp patterns, generated by CRegExp::generateNative
+// in the format of 'colorer -g'. Regenerate the file, when the generator is changed.
+#include <unicode/ustring.h>
+#include "colorer/common/UStr.h"
+#include "colorer/cregexp/cregexp.h"
+
+static inline int colorer_native_0_a2(const SNativeMatch& m, int p)
+{
+  return p < m.end && m.text[p] == 0x61 ? p + 1 : -1;
+}
+
+template <class K>
+static bool colorer_native_0_n1(SNativeMatch& m, int p, const K& k)
+{
+  if (!m.step())
+    return false;
+  int n = 0;
+  int q = p;
+  for (int r; n < 3 && (r = colorer_native_0_a2(m, q)) >= 0; n++)
+    q = r;
+  if (n < 2)
+    return false;
+  while (!k(q)) {
+    if (n == 2 || m.stepLimitHit)
+      return false;
+    n--;
+    q -= 1;
+  }
+  return true;
+}
+
+template <class K>
+static bool colorer_native_0_n0(SNativeMatch& m, int p, const K& k)
+{
+  if (!m.step())
+    return false;
+  int start = p;
+  return colorer_native_0_n1(m, p, [&](int q) {
+    SMatches* mt = m.matches;
+    if (!m.startChange)
+      mt->s[0] = start;
+    if (!m.endChange)
+      mt->e[0] = q;
+    if (mt->e[0] < mt->s[0])
+      mt->s[0] = mt->e[0];
+    return k(q);
+  });
+}
+
+static bool colorer_native_0(SNativeMatch& m, int pos)
+{
+  return colorer_native_0_n0(m, pos, [](int) { return true; });
+}
+
+static const UChar colorer_native_0_pattern[] = {0x2F, 0x61, 0x7B, 0x32, 0x2C, 0x33, 0x7D, 0x2F};
+[[maybe_unused]] static const bool colorer_native_0_registered = CRegExp::registerNative(
+    icu::UnicodeString(colorer_native_0_pattern, 8), colorer_native_0);
+
+static const CharacterClass colorer_native_1_a3_class = [] {
+  icu::UnicodeSet set;
+  set.add(0x0, 0x60);
+  set.add(0x64, 0x10FFFF);
+  return CharacterClass(set);
+}();
+
+static inline int colorer_native_1_a3(const SNativeMatch& m, int p)
+{
+  return m.checkClass(colorer_native_1_a3_class, false, p);
+}
+
+template <class K>
+static bool colorer_native_1_n3(SNativeMatch& m, int p, const K& k)
+{
+  if (!m.step())
+    return false;
+  p = colorer_native_1_a3(m, p);
+  if (p < 0)
+    return false;
+  return k(p);
+}
+
+static const CharacterClass colorer_native_1_a2_class = [] {
+  icu::UnicodeSet set;
+  set.add(0x61, 0x63);
+  return CharacterClass(set);
+}();
+
+static inline int colorer_native_1_a2(const SNativeMatch& m, int p)
+{
+  return m.checkClass(colorer_native_1_a2_class, false, p);
+}
+
+template <class K>
+static bool colorer_native_1_n1(SNativeMatch& m, int p, const K& k)
+{
+  if (!m.step())
+    return false;
+  int n = 0;
+  int q = p;
+  for (int r; (r = colorer_native_1_a2(m, q)) >= 0; n++)
+    q = r;
+  if (n < 1)
+    return false;
+  while (!colorer_native_1_n3(m, q, k)) {
+    if (n == 1 || m.stepLimitHit)
+      return false;
+    n--;
+    q -= (m.surrogates && q - 2 >= p && U16_IS_TRAIL(m.text[q - 1]) && U16_IS_LEAD(m.text[q - 2]) ? 2 : 1);
+  }
+  return true;
+}
+
+template <class K>
+static bool colorer_native_1_n0(SNativeMatch& m, int p, const K& k)
+{
+  if (!m.step())
+    return false;
+  int start = p;
+  return colorer_native_1_n1(m, p, [&](int q) {
+    SMatches* mt = m.matches;
+    if (!m.startChange)
+      mt->s[0] = start;
+    if (!m.endChange)
+      mt->e[0] = q;
+    if (mt->e[0] < mt->s[0])
+      mt->s[0] = mt->e[0];
+    return k(q);
+  });
+}
+
+static bool colorer_native_1(SNativeMatch& m, int pos)
+{
+  return colorer_native_1_n0(m, pos, [](int) { return true; });
+}
+
+static const UChar colorer_native_1_pattern[] = {0x2F, 0x5B, 0x61, 0x2D, 0x63, 0x5D, 0x2B, 0x5B, 0x5E, 0x61, 0x2D, 0x63, 0x5D, 0x2F};
+[[maybe_unused]] static const bool colorer_native_1_registered = CRegExp::registerNative(
+    icu::UnicodeString(colorer_native_1_pattern, 14), colorer_native_1);
+
+template <class K>
+static bool colorer_native_2_n12(SNativeMatch& m, int p, const K& k)
+{
+  if (!m.step())
+    return false;
+  if (!(p == m.end))
+    return false;
+  return k(p);
+}
+
+static inline int colorer_native_2_a11(const SNativeMatch& m, int p)
+{
+  return p < m.end && UStr::isDigit(m.text[p]) ? p + 1 : -1;
+}
+
+template <class K>
+static bool colorer_native_2_n10(SNativeMatch& m, int p, const K& k)
+{
+  if (!m.step())
+    return false;
+  int n = 0;
+  int q = p;
+  for (int r; (r = colorer_native_2_a11(m, q)) >= 0; n++)
+    q = r;
+  if (n < 0)
+    return false;
+  while (!k(q)) {
+    if (n == 0 || m.stepLimitHit)
+      return false;
+    n--;
+    q -= 1;
+  }
+  return true;
+}
+
+static inline int colorer_native_2_a9(const SNativeMatch& m, int p)
+{
+  return p < m.end && m.text[p] == 0x2E ? p + 1 : -1;
+}
+
+template <class K>
+static bool colorer_native_2_n9(SNativeMatch& m, int p, const K& k)
+{
+  if (!m.step())
+    return false;
+  p = colorer_native_2_a9(m, p);
+  if (p < 0)
+    return false;
+  return colorer_native_2_n10(m, p, k);
+}
+
+template <class K>
+static bool colorer_native_2_n8(SNativeMatch& m, int p, const K& k)
+{
+  if (!m.step())
+    return false;
+  int start = p;
+  return colorer_native_2_n9(m, p, [&](int q) {
+    m.matches->s[2] = start;
+    m.matches->e[2] = q;
+    return k(q);
+  });
+}
+
+template <class K>
+static bool colorer_native_2_n7(SNativeMatch& m, int p, const K& k)
+{
+  if (!m.step())
+    return false;
+  if (colorer_native_2_n8(m, p, [&](int q) { return colorer_native_2_n12(m, q, k); }))
+    return true;
+  return colorer_native_2_n12(m, p, k);
+}
+
+static inline int colorer_native_2_a6(const SNativeMatch& m, int p)
+{
+  return p < m.end && UStr::isDigit(m.text[p]) ? p + 1 : -1;
+}
+
+template <class K>
+static bool colorer_native_2_n5(SNativeMatch& m, int p, const K& k)
+{
+  if (!m.step())
+    return false;
+  int n = 0;
+  int q = p;
+  for (int r; (r = colorer_native_2_a6(m, q)) >= 0; n++)
+    q = r;
+  if (n < 1)
+    return false;
+  while (!k(q)) {
+    if (n == 1 || m.stepLimitHit)
+      return false;
+    n--;
+    q -= 1;
+  }
+  return true;
+}
+
+template <class K>
+static bool colorer_native_2_n4(SNativeMatch& m, int p, const K& k)
+{
+  if (!m.step())
+    return false;
+  int start = p;
+  return colorer_native_2_n5(m, p, [&](int q) {
+    m.matches->s[1] = start;
+    m.matches->e[1] = q;
+    return colorer_native_2_n7(m, q, k);
+  });
+}
+
+static inline int colorer_native_2_a3(const SNativeMatch& m, int p)
+{
+  return p < m.end && UStr::isWhitespace(m.text[p]) ? p + 1 : -1;
+}
+
+template <class K>
+static bool colorer_native_2_n2(SNativeMatch& m, int p, const K& k)
+{
+  if (!m.step())
+    return false;
+  int n = 0;
+  int q = p;
+  for (int r; (r = colorer_native_2_a3(m, q)) >= 0; n++)
+    q = r;
+  if (n < 0)
+    return false;
+  while (!colorer_native_2_n4(m, q, k)) {
+    if (n == 0 || m.stepLimitHit)
+      return false;
+    n--;
+    q -= 1;
+  }
+  return true;
+}
+
+template <class K>
+static bool colorer_native_2_n1(SNativeMatch& m, int p, const K& k)
+{
+  if (!m.step())
+    return false;
+  if (!(p == 0))
+    return false;
+  return colorer_native_2_n2(m, p, k);
+}
+
+template <class K>
+static bool colorer_native_2_n0(SNativeMatch& m, int p, const K& k)
+{
+  if (!m.step())
+    return false;
+  int start = p;
+  return colorer_native_2_n1(m, p, [&](int q) {
+    SMatches* mt = m.matches;
+    if (!m.startChange)
+      mt->s[0] = start;
+    if (!m.endChange)
+      mt->e[0] = q;
+    if (mt->e[0] < mt->s[0])
+      mt->s[0] = mt->e[0];
+    return k(q);
+  });
+}
+
+static bool colorer_native_2(SNativeMatch& m, int pos)
+{
+  return colorer_native_2_n0(m, pos, [](int) { return true; });
+}
+
+static const UChar colorer_native_2_pattern[] = {0x2F, 0x5E, 0x5C, 0x73, 0x2A, 0x28, 0x5C, 0x64, 0x2B, 0x29, 0x28, 0x5C, 0x2E, 0x5C, 0x64, 0x2A, 0x29, 0x3F, 0x24, 0x2F};
+[[maybe_unused]] static const bool colorer_native_2_registered = CRegExp::registerNative(
+    icu::UnicodeString(colorer_native_2_pattern, 20), colorer_native_2);
+
+static const UChar colorer_native_3_a1_word[] = {0x61, 0x62, 0x63};
+
+template <class K>
+static bool colorer_native_3_n1(SNativeMatch& m, int p, const K& k)
+{
+  if (!m.step())
+    return false;
+  if (p + 3 > m.end)
+    return false;
+  for (int i = 0; i < 3; i++)
+    if (UStr::foldCase(m.text[p + i]) != colorer_native_3_a1_word[i])
+      return false;
+  return k(p + 3);
+}
+
+template <class K>
+static bool colorer_native_3_n0(SNativeMatch& m, int p, const K& k)
+{
+  if (!m.step())
+    return false;
+  int start = p;
+  return colorer_native_3_n1(m, p, [&](int q) {
+    SMatches* mt = m.matches;
+    if (!m.startChange)
+      mt->s[0] = start;
+    if (!m.endChange)
+      mt->e[0] = q;
+    if (mt->e[0] < mt->s[0])
+      mt->s[0] = mt->e[0];
+    return k(q);
+  });
+}
+
+static bool colorer_native_3(SNativeMatch& m, int pos)
+{
+  return colorer_native_3_n0(m, pos, [](int) { return true; });
+}
+
+static const UChar colorer_native_3_pattern[] = {0x2F, 0x41, 0x42, 0x43, 0x2F, 0x69};
+[[maybe_unused]] static const bool colorer_native_3_registered = CRegExp::registerNative(
+    icu::UnicodeString(colorer_native_3_pattern, 6), colorer_native_3);
+
+static inline int colorer_native_4_a6(const SNativeMatch& m, int p)
+{
+  return p < m.end && m.text[p] == 0x7A ? p + 1 : -1;
+}
+
+template <class K>
+static bool colorer_native_4_n6(SNativeMatch& m, int p, const K& k)
+{
+  if (!m.step())
+    return false;
+  p = colorer_native_4_a6(m, p);
+  if (p < 0)
+    return false;
+  return k(p);
+}
+
+template <class K>
+static bool colorer_native_4_n5(SNativeMatch& m, int p, const K& k)
+{
+  if (!m.step())
+    return false;
+  if (!colorer_native_4_n6(m, p, [](int) { return true; }))
+    return false;
+  return k(p);
+}
+
+static inline int colorer_native_4_a4(const SNativeMatch& m, int p)
+{
+  return p < m.end && m.text[p] == 0x79 ? p + 1 : -1;
+}
+
+template <class K>
+static bool colorer_native_4_n4(SNativeMatch& m, int p, const K& k)
+{
+  if (!m.step())
+    return false;
+  p = colorer_native_4_a4(m, p);
+  if (p < 0)
+    return false;
+  return k(p);
+}
+
+static inline int colorer_native_4_a3(const SNativeMatch& m, int p)
+{
+  return p < m.end && m.text[p] == 0x78 ? p + 1 : -1;
+}
+
+template <class K>
+static bool colorer_native_4_n3(SNativeMatch& m, int p, const K& k)
+{
+  if (!m.step())
+    return false;
+  p = colorer_native_4_a3(m, p);
+  if (p < 0)
+    return false;
+  return k(p);
+}
+
+template <class K>
+static bool colorer_native_4_n2(SNativeMatch& m, int p, const K& k)
+{
+  if (!m.step())
+    return false;
+  if (colorer_native_4_n3(m, p, k))
+    return true;
+  return colorer_native_4_n4(m, p, k);
+}
+
+template <class K>
+static bool colorer_native_4_n1(SNativeMatch& m, int p, const K& k)
+{
+  if (!m.step())
+    return false;
+  return colorer_native_4_n2(m, p, [&](int q) { return colorer_native_4_n5(m, q, k); });
+}
+
+template <class K>
+static bool colorer_native_4_n0(SNativeMatch& m, int p, const K& k)
+{
+  if (!m.step())
+    return false;
+  int start = p;
+  return colorer_native_4_n1(m, p, [&](int q) {
+    SMatches* mt = m.matches;
+    if (!m.startChange)
+      mt->s[0] = start;
+    if (!m.endChange)
+      mt->e[0] = q;
+    if (mt->e[0] < mt->s[0])
+      mt->s[0] = mt->e[0];
+    return k(q);
+  });
+}
+
+static bool colorer_native_4(SNativeMatch& m, int pos)
+{
+  return colorer_native_4_n0(m, pos, [](int) { return true; });
+}
+
+static const UChar colorer_native_4_pattern[] = {0x2F, 0x28, 0x3F, 0x3A, 0x78, 0x7C, 0x79, 0x29, 0x7A, 0x3F, 0x3D, 0x2F};
+[[maybe_unused]] static const bool colorer_native_4_registered = CRegExp::registerNative(
+    icu::UnicodeString(colorer_native_4_pattern, 12), colorer_native_4);
+
+static inline int colorer_native_5_a3(const SNativeMatch& m, int p)
+{
+  return p < m.end && m.text[p] == 0x63 ? p + 1 : -1;
+}
+
+template <class K>
+static bool colorer_native_5_n3(SNativeMatch& m, int p, const K& k)
+{
+  if (!m.step())
+    return false;
+  p = colorer_native_5_a3(m, p);
+  if (p < 0)
+    return false;
+  return k(p);
+}
+
+static inline int colorer_native_5_a2(const SNativeMatch& m, int p)
+{
+  return p < m.end && m.text[p] == 0x62 ? p + 1 : -1;
+}
+
+template <class K>
+static bool colorer_native_5_n2(SNativeMatch& m, int p, const K& k)
+{
+  if (!m.step())
+    return false;
+  p = colorer_native_5_a2(m, p);
+  if (p < 0)
+    return false;
+  return k(p);
+}
+
+template <class K>
+static bool colorer_native_5_n1(SNativeMatch& m, int p, const K& k)
+{
+  if (!m.step())
+    return false;
+  if (p - 1 < 0 || !colorer_native_5_n2(m, p - 1, [](int) { return true; }))
+    return false;
+  return colorer_native_5_n3(m, p, k);
+}
+
+template <class K>
+static bool colorer_native_5_n0(SNativeMatch& m, int p, const K& k)
+{
+  if (!m.step())
+    return false;
+  int start = p;
+  return colorer_native_5_n1(m, p, [&](int q) {
+    SMatches* mt = m.matches;
+    if (!m.startChange)
+      mt->s[0] = start;
+    if (!m.endChange)
+      mt->e[0] = q;
+    if (mt->e[0] < mt->s[0])
+      mt->s[0] = mt->e[0];
+    return k(q);
+  });
+}
+
+static bool colorer_native_5(SNativeMatch& m, int pos)
+{
+  return colorer_native_5_n0(m, pos, [](int) { return true; });
+}
+
+static const UChar colorer_native_5_pattern[] = {0x2F, 0x62, 0x3F, 0x23, 0x31, 0x63, 0x2F};
+[[maybe_unused]] static const bool colorer_native_5_registered = CRegExp::registerNative(
+    icu::UnicodeString(colorer_native_5_pattern, 7), colorer_native_5);
+
+static inline int colorer_native_6_a7(const SNativeMatch& m, int p)
+{
+  return p < m.end && m.text[p] == 0x7A ? p + 1 : -1;
+}
+
+template <class K>
+static bool colorer_native_6_n7(SNativeMatch& m, int p, const K& k)
+{
+  if (!m.step())
+    return false;
+  p = colorer_native_6_a7(m, p);
+  if (p < 0)
+    return false;
+  return k(p);
+}
+
+template <class K>
+static bool colorer_native_6_n6(SNativeMatch& m, int p, const K& k)
+{
+  if (!m.step())
+    return false;
+  m.matches->e[0] = p;
+  m.endChange = true;
+  return colorer_native_6_n7(m, p, k);
+}
+
+static inline int colorer_native_6_a5(const SNativeMatch& m, int p)
+{
+  return p < m.end && m.text[p] == 0x79 ? p + 1 : -1;
+}
+
+template <class K>
+static bool colorer_native_6_n4(SNativeMatch& m, int p, const K& k)
+{
+  if (!m.step())
+    return false;
+  int n = 0;
+  int q = p;
+  for (int r; (r = colorer_native_6_a5(m, q)) >= 0; n++)
+    q = r;
+  if (n < 1)
+    return false;
+  while (!k(q)) {
+    if (n == 1 || m.stepLimitHit)
+      return false;
+    n--;
+    q -= 1;
+  }
+  return true;
+}
+
+template <class K>
+static bool colorer_native_6_n3(SNativeMatch& m, int p, const K& k)
+{
+  if (!m.step())
+    return false;
+  int start = p;
+  return colorer_native_6_n4(m, p, [&](int q) {
+    m.matches->s[1] = start;
+    m.matches->e[1] = q;
+    return colorer_native_6_n6(m, q, k);
+  });
+}
+
+template <class K>
+static bool colorer_native_6_n2(SNativeMatch& m, int p, const K& k)
+{
+  if (!m.step())
+    return false;
+  m.matches->s[0] = p;
+  m.startChange = true;
+  return colorer_native_6_n3(m, p, k);
+}
+
+static inline int colorer_native_6_a1(const SNativeMatch& m, int p)
+{
+  return p < m.end && m.text[p] == 0x78 ? p + 1 : -1;
+}
+
+template <class K>
+static bool colorer_native_6_n1(SNativeMatch& m, int p, const K& k)
+{
+  if (!m.step())
+    return false;
+  p = colorer_native_6_a1(m, p);
+  if (p < 0)
+    return false;
+  return colorer_native_6_n2(m, p, k);
+}
+
+template <class K>
+static bool colorer_native_6_n0(SNativeMatch& m, int p, const K& k)
+{
+  if (!m.step())
+    return false;
+  int start = p;
+  return colorer_native_6_n1(m, p, [&](int q) {
+    SMatches* mt = m.matches;
+    if (!m.startChange)
+      mt->s[0] = start;
+    if (!m.endChange)
+      mt->e[0] = q;
+    if (mt->e[0] < mt->s[0])
+      mt->s[0] = mt->e[0];
+    return k(q);
+  });
+}
+
+static bool colorer_native_6(SNativeMatch& m, int pos)
+{
+  return colorer_native_6_n0(m, pos, [](int) { return true; });
+}
+
+static const UChar colorer_native_6_pattern[] = {0x2F, 0x78, 0x5C, 0x6D, 0x28, 0x79, 0x2B, 0x29, 0x5C, 0x4D, 0x7A, 0x2F};
+[[maybe_unused]] static const bool colorer_native_6_registered = CRegExp::registerNative(
+    icu::UnicodeString(colorer_native_6_pattern, 12), colorer_native_6);
@@ -0,0 +1,42 @@
+#include <colorer/common/UStr.h>
+#include <catch2/catch.hpp>
+
+TEST_CASE("CharacterClass lookup tables match UnicodeSet")
+{
+  const char* classes[] = {"[a-z_]", "[^\\s]", "[{L}\\d]", "[\\x{400}-\\x{4FF}-[\\x{410}]]", "[^a]"};
+  for (auto cls : classes) {
+    UnicodeString str(cls);
+    auto cc = UStr::createCharClass(str, 0, nullptr, false);
+    REQUIRE(cc != nullptr);
+    INFO("class: " << cls);
+    for (UChar32 c = 0; c <= 0xFFFF; c++) {
+      if (cc->contains(static_cast<UChar>(c)) != static_cast<bool>(cc->getSet().contains(c))) {
+        FAIL("code unit " << c);
+      }
+    }
+  }
+}
+
+TEST_CASE("CharacterClass before and after freeze")
+{
+  CharacterClass cc;
+  cc.add('x');
+  cc.add(0x416);
+  CHECK(cc.contains(u'x'));
+  CHECK_FALSE(cc.contains(u'y'));
+  cc.freeze();
+  CHECK(cc.contains(u'x'));
+  CHECK(cc.contains(u'\u0416'));
+  CHECK_FALSE(cc.contains(u'\u0417'));
+}
+
+TEST_CASE("CharacterClass with symbols out of BMP")
+{
+  UnicodeString str(u"[{L}\U0001F600]");
+  auto cc = UStr::createCharClass(str, 0, nullptr, false);
+  REQUIRE(cc != nullptr);
+  CHECK(cc->containsSupplementary(0x1F600));
+  CHECK(cc->containsSupplementary(0x20000));
+  CHECK_FALSE(cc->containsSupplementary(0x1F601));
+  CHECK_FALSE(cc->contains(static_cast<UChar>(0xD83D)));
+}
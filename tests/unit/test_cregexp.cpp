@@ -0,0 +1,646 @@
+#include <colorer/common/UStr.h>
+#include <colorer/cregexp/cregexp.h>
+#include <catch2/catch.hpp>
+#include <tuple>
+#include <vector>
+
+static const char* patterns[] = {
+    R"(/abc/)",
+    R"(/a|b|c/)",
+    R"(/(a|bc)+d/)",
+    R"(/a*?b/)",
+    R"(/a{2,3}/)",
+    R"(/(ab){1,2}?c/)",
+    R"(/[a-c]+[^a-c]/)",
+    R"(/\b\w+\b/)",
+    R"(/^\s*(\d+)(\.\d*)?$/)",
+    R"(/(?{num}\d+)\s+\p{num}/)",
+    R"(/(a)(b)?\2?\1/)",
+    R"(/ABC/i)",
+    R"(/a.c/s)",
+    R"(/(?:x|y)z?=/)",
+    R"(/b?#1c/)",
+    R"(/a?~1b/)",
+    R"(/c?!./)",
+    R"(/x\m(y+)\Mz/)",
+    R"(/~a/)",
+    R"(/\y1/)",
+    R"(/\Y{q}\y{q}/)",
+    R"(/("|')(.*?)\1/)",
+    R"(/\c[a-z]+/)",
+    R"(/(((a)|b)+?c){2,}/)",
+    R"(/"/)",
+    R"(/$/)",
+    R"(/\y2/)",
+};
+
+static const char* subjects[] = {
+    "abc",        "aabcd",      "bcbcd",     "aaab",    "  12.5",  "42 42",    "abab",
+    "ABCabc",     "a\nc",       "xz",        "xyyz",    "bcb",     "\"x\" 'y'", "a c aab",
+    "ab abc ABc", "aabbccdd c", "abcbacbac", "aa bb a", "",        "word_1 z", "AaA",
+};
+
+// matcher of /[xy]/, which is written as the generated one, but matches only 'x'
+static bool matchX(SNativeMatch& m, int pos)
+{
+  if (pos >= m.end || m.text[pos] != 'x')
+    return false;
+  m.matches->s[0] = pos;
+  m.matches->e[0] = pos + 1;
+  return true;
+}
+
+TEST_CASE("Program and tree engines of CRegExp give the same results")
+{
+  UnicodeString back_re("/(?{q}[\"'])(a)/");
+  CRegExp back(&back_re);
+  UnicodeString back_str("'a");
+  SMatches back_match {};
+  REQUIRE(back.parse(&back_str, &back_match));
+
+  RegExpContext ctx;
+  for (auto pattern : patterns) {
+    UnicodeString pattern_str(pattern);
+    CRegExp tree_re;
+    CRegExp prog_re;
+    tree_re.setBackRE(&back);
+    prog_re.setBackRE(&back);
+    tree_re.setRE(&pattern_str);
+    prog_re.setRE(&pattern_str);
+    REQUIRE(tree_re.isOk());
+    tree_re.setEngine(EEngine::Tree);
+    prog_re.setEngine(EEngine::Program);
+
+    for (auto subject : subjects) {
+      UnicodeString str(subject);
+      int len = str.length();
+      for (int moves = 0; moves < 2; moves++) {
+        for (int pos = 0; pos <= len; pos++) {
+          INFO("pattern: " << pattern << ", subject: " << subject << ", pos: " << pos
+                           << ", moves: " << moves);
+          SMatches tree_match {};
+          SMatches prog_match {};
+          bool tree_res = tree_re.parse(&str, pos, len, &tree_match, 0, moves, &back_str,
+                                        &back_match, &ctx);
+          bool prog_res = prog_re.parse(&str, pos, len, &prog_match, 0, moves, &back_str,
+                                        &back_match, &ctx);
+          REQUIRE(tree_res == prog_res);
+          if (!tree_res)
+            continue;
+          REQUIRE(tree_match.cMatch == prog_match.cMatch);
+          for (int i = 0; i < tree_match.cMatch; i++) {
+            CHECK(tree_match.s[i] == prog_match.s[i]);
+            CHECK(tree_match.e[i] == prog_match.e[i]);
+          }
+          REQUIRE(tree_match.cnMatch == prog_match.cnMatch);
+          for (int i = 0; i < tree_match.cnMatch; i++) {
+            CHECK(tree_match.ns[i] == prog_match.ns[i]);
+            CHECK(tree_match.ne[i] == prog_match.ne[i]);
+          }
+        }
+      }
+    }
+  }
+}
+
+// matchers of some patterns are generated into cregexp_native.cpp
+TEST_CASE("Generated matchers of CRegExp give the same results as the program engine")
+{
+  RegExpContext ctx;
+  int generated = 0;
+  for (auto pattern : patterns) {
+    UnicodeString pattern_str(pattern);
+    CRegExpNative native = CRegExp::findNative(pattern_str);
+    if (!native)
+      continue;
+    generated++;
+    CRegExp native_re(&pattern_str);
+    CRegExp prog_re(&pattern_str);
+    REQUIRE(native_re.isOk());
+    native_re.setNative(native);
+    prog_re.setEngine(EEngine::Program);
+
+    for (auto subject : subjects) {
+      UnicodeString str(subject);
+      int len = str.length();
+      for (int moves = 0; moves < 2; moves++) {
+        for (int pos = 0; pos <= len; pos++) {
+          INFO("pattern: " << pattern << ", subject: " << subject << ", pos: " << pos
+                           << ", moves: " << moves);
+          SMatches native_match {};
+          SMatches prog_match {};
+          bool native_res = native_re.parse(&str, pos, len, &native_match, 0, moves, &ctx);
+          bool prog_res = prog_re.parse(&str, pos, len, &prog_match, 0, moves, &ctx);
+          REQUIRE(native_res == prog_res);
+          if (!native_res)
+            continue;
+          REQUIRE(native_match.cMatch == prog_match.cMatch);
+          for (int i = 0; i < native_match.cMatch; i++) {
+            CHECK(native_match.s[i] == prog_match.s[i]);
+            CHECK(native_match.e[i] == prog_match.e[i]);
+          }
+        }
+      }
+    }
+  }
+  CHECK(generated == 7);
+}
+
+TEST_CASE("Check CRegExp matches")
+{
+  SMatches match {};
+
+  SECTION("brackets and quantifiers")
+  {
+    UnicodeString re_str("/(a|bc)+d/");
+    CRegExp re(&re_str);
+    UnicodeString str("xbcad");
+    REQUIRE(re.parse(&str, 0, str.length(), &match, 0, 1));
+    CHECK(match.s[0] == 1);
+    CHECK(match.e[0] == 5);
+    CHECK(match.s[1] == 3);
+    CHECK(match.e[1] == 4);
+  }
+  SECTION("named brackets and backreference")
+  {
+    UnicodeString re_str("/(?{num}\\d+)\\s+\\p{num}/");
+    CRegExp re(&re_str);
+    UnicodeString str("42 42");
+    REQUIRE(re.parse(&str, &match));
+    CHECK(match.ns[0] == 0);
+    CHECK(match.ne[0] == 2);
+    UnicodeString str2("42 43");
+    CHECK_FALSE(re.parse(&str2, &match));
+  }
+  SECTION("zero bracket bounds change")
+  {
+    UnicodeString re_str("/x\\m(y+)\\Mz/");
+    CRegExp re(&re_str);
+    UnicodeString str("xyyz");
+    REQUIRE(re.parse(&str, &match));
+    CHECK(match.s[0] == 1);
+    CHECK(match.e[0] == 3);
+  }
+  SECTION("DFA prefilter doesn't reject backtracker matches")
+  {
+    UnicodeString re_str("/(a|ab){2}c/");
+    CRegExp re(&re_str);
+    UnicodeString str("abc");
+    CHECK(re.parse(&str, &match));
+    UnicodeString str2("abd");
+    CHECK_FALSE(re.parse(&str2, &match));
+  }
+  SECTION("first symbols and minimal length of alternatives")
+  {
+    UnicodeString re_str("/(?:x?[0-9]|\\s\\w{2})z/i");
+    CRegExp re(&re_str);
+    UnicodeString str("X5Z");
+    CHECK(re.parse(&str, &match));
+    UnicodeString str2(" abz");
+    CHECK(re.parse(&str2, &match));
+    UnicodeString str3("yx5z");
+    CHECK_FALSE(re.parse(&str3, &match));
+    CHECK(re.parse(&str3, 0, str3.length(), &match, 0, 1));
+    CHECK(match.s[0] == 1);
+    UnicodeString str4("5");
+    CHECK_FALSE(re.parse(&str4, &match));
+  }
+  SECTION("required literal")
+  {
+    UnicodeString re_str("/\\w\\s?(\\d)=end|x+=end/");
+    CRegExp re(&re_str);
+    UnicodeString str("a 1=en b2=end");
+    REQUIRE(re.parse(&str, 0, str.length(), &match, 0, 1));
+    CHECK(match.s[0] == 7);
+    CHECK(match.s[1] == 8);
+    UnicodeString re2_str("/<(\\w+)>end/");
+    CRegExp re2(&re2_str);
+    UnicodeString str2("<a>en <b>end");
+    REQUIRE(re2.parse(&str2, 0, str2.length(), &match, 0, 1));
+    CHECK(match.s[0] == 6);
+    CHECK_FALSE(re2.parse(&str2, 7, str2.length(), &match, 0, 1));
+  }
+  SECTION("case insensitive words")
+  {
+    UnicodeString re_str("/stra\\x{DF}e|KELVIN/i");
+    CRegExp re(&re_str);
+    UnicodeString str = UnicodeString("STRA\\u1E9EE").unescape();
+    CHECK(re.parse(&str, &match));
+    UnicodeString str2("STRASSE");
+    CHECK_FALSE(re.parse(&str2, &match));
+    UnicodeString str3 = UnicodeString("\\u212Aelvin").unescape();
+    CHECK(re.parse(&str3, &match));
+    UnicodeString str4("kelvi");
+    CHECK_FALSE(re.parse(&str4, &match));
+    UnicodeString re2_str("/\\x{DF}x/i");
+    CRegExp re2(&re2_str);
+    UnicodeString str5("ssx");
+    CHECK_FALSE(re2.parse(&str5, &match));
+    UnicodeString str6 = UnicodeString("\\u1E9EX").unescape();
+    CHECK(re2.parse(&str6, &match));
+  }
+  SECTION("possible start symbols")
+  {
+    UnicodeString re_str("/(if|else)\\b|\\d+/i");
+    CRegExp re(&re_str);
+    re.setPositionMoves(false);
+    CHECK(re.canStartWith('I'));
+    CHECK(re.canStartWith('e'));
+    CHECK(re.canStartWith('7'));
+    CHECK_FALSE(re.canStartWith('x'));
+    re.setPositionMoves(true);
+    CHECK(re.canStartWith('x'));
+    UnicodeString re2_str("/x?/");
+    CRegExp re2(&re2_str);
+    CHECK(re2.canStartWith('y'));
+  }
+  SECTION("steps limit")
+  {
+    UnicodeString re_str("/(x?)(a*)*b\\1/");
+    CRegExp re(&re_str);
+    UnicodeString str("aaaaaaaaaaaaaaaaaaaaaaaaa");
+    RegExpContext ctx;
+    ctx.setStepLimit(10000);
+    for (auto engine : {EEngine::Tree, EEngine::Program}) {
+      re.setEngine(engine);
+      CHECK_FALSE(re.parse(&str, &match, &ctx));
+      CHECK(ctx.getLastResult() == EMatchResult::StepLimit);
+    }
+    CHECK(re.getStepLimitHits() == 2);
+    UnicodeString str2("aab");
+    CHECK(re.parse(&str2, &match, &ctx));
+    CHECK(ctx.getLastResult() == EMatchResult::Match);
+    re.setStepLimit(5);
+    CHECK_FALSE(re.parse(&str2, &match, &ctx));
+    CHECK(ctx.getLastResult() == EMatchResult::StepLimit);
+  }
+  SECTION("ranges states memo")
+  {
+    UnicodeString str(500, 'a', 500);
+    RegExpContext ctx;
+    ctx.setStepLimit(1000000);
+    for (const char* pattern :
+         {"/(?:a*)*b/", "/(?:a?)*b/", "/(?:a|aa)*c/", "/(?:a*?)*?b/", "/x|(?:a+)+b/"}) {
+      UnicodeString re_str(pattern);
+      CRegExp re(&re_str);
+      for (auto engine : {EEngine::Tree, EEngine::Program}) {
+        re.setEngine(engine);
+        CHECK_FALSE(re.parse(&str, &match, &ctx));
+        CHECK(ctx.getLastResult() == EMatchResult::NoMatch);
+      }
+    }
+    UnicodeString re_str("/(a|aa)*(a)c/");
+    CRegExp re(&re_str);
+    UnicodeString str2 = str + "c";
+    CHECK(re.parse(&str2, &match, &ctx));
+    CHECK(match.s[0] == 0);
+    CHECK(match.s[2] == 499);
+    // brackets, written by the failed branches, stay in the match, so such ranges have no memo;
+    // lookahead c?! turns off the DFA prefilter
+    UnicodeString nocap_str("/c?!(?:a*)*b/");
+    CRegExp nocap(&nocap_str);
+    CHECK_FALSE(nocap.parse(&str, &match, &ctx));
+    CHECK(ctx.getLastResult() == EMatchResult::NoMatch);
+    for (const char* pattern : {"/c?!(a*)*b/", "/c?!(?:a*)*(b)/", "/c?!((?:a|aa)*)c/"}) {
+      UnicodeString cap_str(pattern);
+      CRegExp cap(&cap_str);
+      CHECK_FALSE(cap.parse(&str, &match, &ctx));
+      CHECK(ctx.getLastResult() == EMatchResult::StepLimit);
+    }
+    UnicodeString bk_str("/(a*)*b\\1/");
+    CRegExp bk(&bk_str);
+    CHECK_FALSE(bk.parse(&str, &match, &ctx));
+    CHECK(ctx.getLastResult() == EMatchResult::StepLimit);
+  }
+  SECTION("ranges states memo on the long line")
+  {
+    // the parser checks RE at each position of the line, the memo is reused by the calls
+    UnicodeString re_str("/\\w+\\s*x?=y/");
+    CRegExp re(&re_str);
+    RegExpContext ctx;
+    auto scan = [&](const UnicodeString& line) {
+      int found = 0;
+      for (int pos = 0; pos <= line.length(); pos++) {
+        found += re.parse(&line, pos, line.length(), &match, 0, -1, &ctx);
+      }
+      return found;
+    };
+    auto make_line = [](int length) {
+      UnicodeString line;
+      while (line.length() < length) {
+        line += "abcdefghijklmnopqrstuvwxyz ";
+      }
+      return line;
+    };
+    // failures of the previous call don't stay in the memo
+    UnicodeString re2_str("/c?!(?:a|aa)*c/");
+    CRegExp re2(&re2_str);
+    UnicodeString no_c = UnicodeString(500, 'a', 500) + "xc";
+    CHECK_FALSE(re2.parse(&no_c, 0, no_c.length(), &match, 0, 1, &ctx));
+    UnicodeString with_c = UnicodeString(250, 'a', 250) + "x" + UnicodeString(248, 'a', 248) + "c";
+    REQUIRE(re2.parse(&with_c, 0, with_c.length(), &match, 0, 1, &ctx));
+    CHECK(match.s[0] == 251);
+
+    auto scan_steps = [&](const UnicodeString& line) {
+      RegExpProfile profile;
+      ctx.setProfile(&profile);
+      CHECK(scan(line) == 0);
+      ctx.setProfile(nullptr);
+      return profile.stats[&re].steps;
+    };
+    // work grows linearly with the line length, 64 times longer line is given 128 times more
+    uint64_t short_steps = scan_steps(make_line(4000));
+    uint64_t long_steps = scan_steps(make_line(256000));
+    CHECK(short_steps > 0);
+    CHECK(long_steps < short_steps * 128);
+  }
+  SECTION("brackets of the failed branches with the ranges states memo")
+  {
+    // expected brackets are given by the matcher without the memo
+    UnicodeString back_re("/(?{q}[\"'a])(b)?/");
+    CRegExp back(&back_re);
+    UnicodeString back_str("'b");
+    SMatches back_match {};
+    REQUIRE(back.parse(&back_str, &back_match));
+    UnicodeString str("abababababababababc");
+    const std::tuple<const char*, std::vector<int>, std::vector<int>> cases[] = {
+        {R"(/\S(?{n}[ab ])*?__?~1|\w+?(\d{2,}?|[a-c]{2,}?(?:\y2{1,2}( ??){2,}?)abc)*?abc{1,3}?|\y1?#2_*?\labc/)",
+         {0, 19, 19, 19, 19, 19}, {17, 18}},
+        {R"(/(\c?!([a-c]a(?: ?abbc{1,2}))\B?!)+|\y{q}*(\u|\m(\l(b\b?![ab ]*.)[ab ]{1,2}[^a]){2,}(\l(?{n}[^a]\l{1,3}?|\l\w\B) \d{1,2})b|ab{2}|\y2 ??)/i)",
+         {0, 0, -1, -1, -1, -1, 0, 0, 18, 18, 15, 15, -1, -1}, {7, 9}},
+        {R"(/\W??bc{0,1}\Y1|(\m?#1)([a-c]+\y2{2,}?|\s{2,}1){2,}\wab/)", {0, 18, 1, 1, 18, 19}, {}},
+    };
+    RegExpContext ctx;
+    for (const auto& [pattern, brackets, named] : cases) {
+      UnicodeString re_str(pattern);
+      CRegExp re;
+      re.setBackRE(&back);
+      re.setRE(&re_str);
+      REQUIRE(re.isOk());
+      for (auto engine : {EEngine::Tree, EEngine::Program}) {
+        INFO(pattern);
+        re.setEngine(engine);
+        SMatches m {};
+        REQUIRE(re.parse(&str, 0, str.length(), &m, 0, 1, &back_str, &back_match, &ctx));
+        REQUIRE(m.cMatch * 2 == static_cast<int>(brackets.size()));
+        for (int i = 0; i < m.cMatch; i++) {
+          CHECK(m.s[i] == brackets[i * 2]);
+          CHECK(m.e[i] == brackets[i * 2 + 1]);
+        }
+        REQUIRE(m.cnMatch * 2 == static_cast<int>(named.size()));
+        for (int i = 0; i < m.cnMatch; i++) {
+          CHECK(m.ns[i] == named[i * 2]);
+          CHECK(m.ne[i] == named[i * 2 + 1]);
+        }
+      }
+    }
+  }
+  SECTION("ambiguous repeats")
+  {
+    auto analyze = [](const char* pattern) {
+      UnicodeString re_str(pattern);
+      CRegExp re(&re_str);
+      return re.findAmbiguities();
+    };
+    for (const char* pattern : {"/\"(\\\\.|[^\\\\\"])*\"/", "/(a+b)*/", "/(ab|ac)+/", "/(a|ab)*/",
+                                "/(\\w+)\\s+/", "/(\\l{2})+/", "/(a|)*/"})
+      CHECK(analyze(pattern).empty());
+
+    auto nested = analyze("/(?:a*)*b/");
+    REQUIRE(nested.size() == 1);
+    CHECK(nested[0].kind == EReAmbiguity::NestedRepeat);
+    CHECK(nested[0].s == 0);
+    CHECK(nested[0].e == -1);
+    // top level repeat has the range states memo
+    CHECK_FALSE(nested[0].exponential);
+    for (const char* pattern : {"/(\\w+\\s?)*;/", "/(a?\\d{1,3})+/"})
+      CHECK(analyze(pattern).size() == 1);
+
+    for (const char* pattern : {"/(\\w|\\d)+/", "/(a|aa)*c/", "/(?:ab|a\\w)*/"}) {
+      auto found = analyze(pattern);
+      REQUIRE(found.size() == 1);
+      CHECK(found[0].kind == EReAmbiguity::OverlappingOr);
+    }
+
+    // repeats without memo: nested into other repeats, lookarounds, with backreferences or brackets
+    for (const char* pattern : {"/((a+)+y)*z/", "/x(?:(a+)+y)?=/", "/((a|a)+)\\1/", "/(a|a){1,20}/",
+                                "/(a*)*b/"}) {
+      auto found = analyze(pattern);
+      REQUIRE(found.size() == 1);
+      CHECK(found[0].exponential);
+    }
+    CHECK_FALSE(analyze("/(a|a){1,3}/")[0].exponential);
+  }
+  SECTION("special kinds")
+  {
+    const std::pair<const char*, EReKind> kinds[] = {
+        {R"(/"/)", EReKind::Literal},      {R"(/\*\//)", EReKind::Literal},
+        {R"(/$/)", EReKind::EndOfLine},    {R"(/\y1/)", EReKind::BackTrace},
+        {R"(/"/i)", EReKind::General},     {R"(/a|b/)", EReKind::General},
+        {R"(/(a)/)", EReKind::General},    {R"(/\Y1/)", EReKind::General},
+        {R"(/a$/)", EReKind::General},     {R"(/$/m)", EReKind::General},
+    };
+    for (const auto& kind : kinds) {
+      UnicodeString re_str(kind.first);
+      CRegExp re(&re_str);
+      INFO(kind.first);
+      CHECK(re.getKind() == kind.second);
+    }
+    UnicodeString re_str("/\\*\\//");
+    CRegExp re(&re_str);
+    UnicodeString str("a */ b */");
+    REQUIRE(re.parse(&str, 5, str.length(), &match, 0, 1));
+    CHECK(match.s[0] == 7);
+    CHECK(match.e[0] == 9);
+    CHECK_FALSE(re.parse(&str, 5, str.length(), &match, 0, 0));
+    UnicodeString eol_str("/$/");
+    CRegExp eol(&eol_str);
+    REQUIRE(eol.parse(&str, 0, 4, &match, 0, 1));
+    CHECK(match.s[0] == 4);
+    CHECK(match.e[0] == 4);
+  }
+  SECTION("surrogate pairs")
+  {
+    // U+1F600 is not a letter, U+20000 is a letter
+    UnicodeString str(u"a\U0001F600\U00020000b");
+    const std::tuple<const char16_t*, int, int> patterns[] = {
+        {u"/^a.\\w+$/", 0, 6}, {u"/^a\\W\\w/", 0, 5},    {u"/^a[^a][\\w]b/", 0, 6},
+        {u"/a.{2}b/", 0, 6},   {u"/.\U00020000/", 1, 5}, {u"/.b/", 3, 6},
+        {u"/\\wb/", 3, 6},     {u"/[{So}]/", 1, 3},      {u"/[\U0001F600]/", 1, 3},
+    };
+    RegExpContext ctx;
+    for (const auto& [pattern, start, end] : patterns) {
+      UnicodeString re_str(pattern);
+      CRegExp re(&re_str);
+      INFO(UStr::to_stdstr(&re_str));
+      for (auto engine : {EEngine::Tree, EEngine::Program}) {
+        re.setEngine(engine);
+        REQUIRE(re.parse(&str, 0, str.length(), &match, 0, 1, &ctx));
+        CHECK(match.s[0] == start);
+        CHECK(match.e[0] == end);
+      }
+    }
+    UnicodeString any_str("/.$/");
+    CRegExp any(&any_str);
+    CHECK(any.parse(&str, 1, 3, &match, 0, 0, &ctx));
+    // marked line is matched by code units
+    ctx.setSurrogateFree(&str);
+    CHECK_FALSE(any.parse(&str, 1, 3, &match, 0, 0, &ctx));
+    UnicodeString ascii("ab");
+    CHECK(any.parse(&ascii, 1, 2, &match, 0, 0, &ctx));
+  }
+  SECTION("copy of the used brackets")
+  {
+    UnicodeString re_str("/(a)(?{x}b)/");
+    CRegExp re(&re_str);
+    UnicodeString str("xab");
+    REQUIRE(re.parse(&str, 0, str.length(), &match, 0, 1));
+    SMatches copy {};
+    copy.s[2] = 7;
+    copy.copyUsed(match);
+    CHECK(copy.cMatch == 2);
+    CHECK(copy.s[0] == 1);
+    CHECK(copy.e[1] == 2);
+    CHECK(copy.s[2] == 7);
+    CHECK(copy.cnMatch == 1);
+    CHECK(copy.ns[0] == 2);
+    CHECK(copy.ne[0] == 3);
+  }
+  SECTION("generated matchers")
+  {
+    for (auto pattern : {"/^\\s*(\\d+)(\\.\\d*)?$/", "/x\\m(y+)\\Mz/", "/~a/", "/c?!./", "/[a-c]+?b/i"}) {
+      UnicodeString re_str(pattern);
+      CRegExp re(&re_str);
+      std::string code;
+      INFO(pattern);
+      CHECK(re.generateNative(code, "native"));
+      CHECK(code.find("static bool native(SNativeMatch& m, int pos)") != std::string::npos);
+    }
+    // backreference, repeated group and literal, which is matched directly
+    for (auto pattern : {"/(a)\\1/", "/(a|bc)+d/", "/abc/"}) {
+      UnicodeString re_str(pattern);
+      CRegExp re(&re_str);
+      std::string code;
+      INFO(pattern);
+      CHECK_FALSE(re.generateNative(code, "native"));
+      CHECK(code.empty());
+    }
+
+    UnicodeString re_str("/[xy]/");
+    CRegExp re(&re_str);
+    re.setNative(matchX);
+    UnicodeString str("yyx");
+    CHECK_FALSE(re.parse(&str, 0, str.length(), &match, 0, 0));
+    REQUIRE(re.parse(&str, 0, str.length(), &match, 0, 1));
+    CHECK(match.s[0] == 2);
+    CHECK(match.e[0] == 3);
+    re.setNative(nullptr);
+    CHECK(re.parse(&str, 0, str.length(), &match, 0, 0));
+
+    CHECK(CRegExp::registerNative(re_str, matchX));
+    CHECK(CRegExp::findNative(re_str) == matchX);
+    CHECK(CRegExp::findNative(UnicodeString("/[xyz]/")) == nullptr);
+  }
+  SECTION("parse calls profile")
+  {
+    UnicodeString re_str("/a/");
+    CRegExp re(&re_str);
+    UnicodeString str("aba");
+    RegExpContext ctx;
+    RegExpProfile profile;
+    ctx.setProfile(&profile);
+    for (int pos = 0; pos < str.length(); pos++) re.parse(&str, pos, str.length(), &match, 0, 0, &ctx);
+    ctx.setProfile(nullptr);
+    re.parse(&str, 0, str.length(), &match, 0, 0, &ctx);
+    CHECK(profile.stats[&re].calls == 3);
+    CHECK(profile.stats[&re].matches == 2);
+
+    UnicodeString bt_str("/(a|b)+c/");
+    CRegExp bt(&bt_str);
+    UnicodeString bt_line("ababc");
+    for (auto eng : {EEngine::Tree, EEngine::Program}) {
+      bt.setEngine(eng);
+      RegExpProfile bt_profile;
+      ctx.setProfile(&bt_profile);
+      CHECK(bt.parse(&bt_line, 0, bt_line.length(), &match, 0, 0, &ctx));
+      ctx.setProfile(nullptr);
+      CHECK(bt_profile.stats[&bt].steps > 0);
+      CHECK(bt_profile.stats[&bt].depth > 0);
+    }
+  }
+  SECTION("backtrace into another regexp")
+  {
+    UnicodeString start_str("/([\"'])/");
+    CRegExp start(&start_str);
+    UnicodeString end_str("/\\y1/");
+    CRegExp end;
+    end.setBackRE(&start);
+    end.setRE(&end_str);
+    UnicodeString str("'abc' \"d\"");
+    SMatches start_match {};
+    REQUIRE(start.parse(&str, 6, str.length(), &start_match, 0, 0));
+    REQUIRE(end.parse(&str, 7, str.length(), &match, 0, 1, &str, &start_match));
+    CHECK(match.s[0] == 8);
+  }
+  SECTION("copy of the used backtrace brackets")
+  {
+    UnicodeString start_str(R"(/(\w+)\s*(?{q}["'])(x)?/)");
+    CRegExp start(&start_str);
+    UnicodeString end_str(R"(/\y{q}\s*\Y1/)");
+    CRegExp end;
+    end.setBackRE(&start);
+    end.setRE(&end_str);
+    UnicodeString plain_str("/\"/");
+    CRegExp plain(&plain_str);
+    CHECK(end.hasBackTrace());
+    CHECK_FALSE(plain.hasBackTrace());
+
+    UnicodeString str("  name 'text' NAME");
+    SMatches start_match {};
+    REQUIRE(start.parse(&str, 0, str.length(), &start_match, 0, 1));
+    UnicodeString bk_str;
+    SMatches bk_match {};
+    end.copyBackTrace(str, start_match, bk_str, bk_match);
+    CHECK(bk_str == UnicodeString("name'"));
+    CHECK(bk_match.s[0] == -1);
+    CHECK(bk_match.s[2] == -1);
+    for (auto eng : {EEngine::Tree, EEngine::Program}) {
+      end.setEngine(eng);
+      REQUIRE(end.parse(&str, 12, str.length(), &match, 0, 0, &bk_str, &bk_match));
+      CHECK(match.e[0] == str.length());
+    }
+  }
+  SECTION("copied backtrace matches as the whole line one")
+  {
+    UnicodeString start_str(R"(/(\w+)\s*(?{q}["'])(?{w}\w+)/)");
+    CRegExp start(&start_str);
+    UnicodeString str("  name 'Text' NAME' text' name Text");
+    SMatches start_match {};
+    REQUIRE(start.parse(&str, 0, str.length(), &start_match, 0, 1));
+
+    for (auto end_pattern : {R"(/\y1/)", R"(/\Y1/)", R"(/\y{q}/)", R"(/\Y{q}/)", R"(/\y{w}/)",
+                             R"(/\Y{w}/)", R"(/\Y{w}\y{q}/)"}) {
+      UnicodeString end_str(end_pattern);
+      CRegExp end;
+      end.setBackRE(&start);
+      end.setRE(&end_str);
+      REQUIRE(end.hasBackTrace());
+      UnicodeString bk_str;
+      SMatches bk_match {};
+      end.copyBackTrace(str, start_match, bk_str, bk_match);
+      for (auto eng : {EEngine::Tree, EEngine::Program}) {
+        INFO("pattern: " << end_pattern << ", engine: " << (eng == EEngine::Tree ? "tree" : "program"));
+        end.setEngine(eng);
+        SMatches line_match {};
+        SMatches copy_match {};
+        bool line_res = end.parse(&str, 12, str.length(), &line_match, 0, 1, &str, &start_match);
+        bool copy_res = end.parse(&str, 12, str.length(), &copy_match, 0, 1, &bk_str, &bk_match);
+        REQUIRE(line_res);
+        REQUIRE(copy_res);
+        CHECK(line_match.s[0] == copy_match.s[0]);
+        CHECK(line_match.e[0] == copy_match.e[0]);
+        CHECK(copy_match.e[0] > copy_match.s[0]);
+      }
+    }
+  }
+}
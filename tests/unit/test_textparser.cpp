@@ -0,0 +1,194 @@
+#include <colorer/ParserFactory.h>
+#include <colorer/common/UStr.h>
+#include <colorer/xml/XmlInputSource.h>
+#include <spdlog/sinks/null_sink.h>
+#include <catch2/catch.hpp>
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <map>
+
+namespace fs = std::filesystem;
+
+namespace {
+
+const char* const test_hrc = R"(<?xml version="1.0" encoding="UTF-8"?>
+<hrc version="take5">
+  <prototype name="test" group="test" description="test">
+    <filename>/\.tst$/</filename>
+  </prototype>
+  <type name="test">
+    <region name="Comment"/>
+    <region name="Symbol"/>
+    <region name="Number"/>
+    <region name="Keyword"/>
+    <scheme name="comment">
+      <regexp match="/\bTODO\b/" region="Keyword"/>
+    </scheme>
+    <scheme name="test">
+      <block start="/\/\*/" end="/\*\//" scheme="comment" region="Comment"/>
+      <block start="/(\{)/" end="/(\})/" scheme="test" region00="Symbol" region10="Symbol"/>
+      <regexp match="/\b\d+\b/" region="Number"/>
+      <keywords region="Keyword">
+        <word name="if"/>
+        <word name="else"/>
+      </keywords>
+    </scheme>
+  </type>
+</hrc>
+)";
+
+/** Records the parse events as strings. */
+class RecordingHandler : public RegionHandler
+{
+ public:
+  void clearLine(size_t lno, UnicodeString* /*line*/) override
+  {
+    events.push_back("line " + std::to_string(lno));
+  }
+
+  void addRegion(size_t lno, UnicodeString* /*line*/, int sx, int ex, const Region* region) override
+  {
+    events.push_back(position(lno, sx, ex) + UStr::to_stdstr(region->getName()));
+  }
+
+  void enterScheme(size_t lno, UnicodeString* /*line*/, int sx, int ex, const Region* region,
+                   const Scheme* scheme) override
+  {
+    events.push_back(position(lno, sx, ex) + "enter " + UStr::to_stdstr(scheme->getName()) + " " +
+                     (region ? UStr::to_stdstr(region->getName()) : ""));
+  }
+
+  void leaveScheme(size_t lno, UnicodeString* /*line*/, int sx, int ex, const Region* region,
+                   const Scheme* scheme) override
+  {
+    events.push_back(position(lno, sx, ex) + "leave " + UStr::to_stdstr(scheme->getName()) + " " +
+                     (region ? UStr::to_stdstr(region->getName()) : ""));
+  }
+
+  std::vector<std::string> events;
+
+ private:
+  static std::string position(size_t lno, int sx, int ex)
+  {
+    return std::to_string(lno) + ":" + std::to_string(sx) + "-" + std::to_string(ex) + " ";
+  }
+};
+
+/** Lines of the text in memory, can be read from several threads. */
+class VectorLineSource : public LineSource
+{
+ public:
+  UnicodeString* getLine(size_t lno) override
+  {
+    return lno < lines.size() ? &lines[lno] : nullptr;
+  }
+
+  std::vector<UnicodeString> lines;
+};
+
+/** Loads hrc text into the library of the factory. */
+void loadHrc(ParserFactory& pf, const std::string& hrc, const std::string& file_name)
+{
+  auto hrc_path = fs::temp_directory_path() / file_name;
+  std::ofstream(hrc_path) << hrc;
+  UnicodeString path(hrc_path.c_str());
+  pf.getHrcLibrary().loadSource(XmlInputSource::newInstance(&path, nullptr).get());
+  fs::remove(hrc_path);
+}
+
+void disableLogging()
+{
+  spdlog::drop_all();
+  auto log = spdlog::null_logger_mt("main");
+  spdlog::set_default_logger(log);
+}
+
+/**
+  Text with the blocks over the borders of the parallel parse chunks:
+  special lines are given by their numbers, other lines are simple statements.
+*/
+std::vector<UnicodeString> makeText(int count, const std::map<int, std::string>& special)
+{
+  std::vector<UnicodeString> text;
+  text.reserve(count);
+  for (int i = 0; i < count; i++) {
+    auto it = special.find(i);
+    std::string line = it != special.end() ? it->second : "x = " + std::to_string(i) + "; if (y) z;";
+    text.emplace_back(line.c_str());
+  }
+  return text;
+}
+
+}  // namespace
+
+TEST_CASE("Parallel parse gives the same events as the serial parse")
+{
+  disableLogging();
+  ParserFactory pf;
+  loadHrc(pf, test_hrc, "colorer_test_parallel.hrc");
+  UnicodeString type_name("test");
+  FileType* type = pf.getHrcLibrary().getFileType(&type_name);
+  REQUIRE(type != nullptr);
+
+  VectorLineSource text;
+  text.lines = makeText(3000, {{450, "{ 1"},
+                               {485, "/* TODO start"},
+                               {492, "{ 2 if not a block"},
+                               {505, "end */ 3 {"},
+                               {506, "}"},
+                               {980, "else { 4"},
+                               {995, "/* in nested"},
+                               {1005, "*/ 5 }"},
+                               {1010, "} 6"},
+                               {1620, "} 7"},
+                               {2490, "if { /* TODO */ 8"},
+                               {2510, "} 9"},
+                               {2999, "/* not closed"}});
+
+  auto parse = [&](bool parallel) {
+    RecordingHandler handler;
+    TextParser parser;
+    parser.setFileType(type);
+    parser.setLineSource(&text);
+    parser.setRegionHandler(&handler);
+    int end = parallel ? parser.parseParallel(0, 3000, 4)
+                       : parser.parse(0, 3000, TextParser::TextParseMode::TPM_CACHE_OFF);
+    CHECK(end == 2999);
+    return handler.events;
+  };
+
+  auto serial = parse(false);
+  CHECK(std::count(serial.begin(), serial.end(), "2490:5-7 enter test:comment test:Comment") == 1);
+  CHECK(parse(true) == serial);
+
+  SECTION("breakParse stops the parse threads")
+  {
+    class BreakingHandler : public RecordingHandler
+    {
+     public:
+      void clearLine(size_t lno, UnicodeString* line) override
+      {
+        RecordingHandler::clearLine(lno, line);
+        last_line = std::max(last_line, static_cast<int>(lno));
+        if (lno == 100) {
+          parser->breakParse();
+        }
+      }
+      TextParser* parser = nullptr;
+      int last_line = -1;
+    };
+    BreakingHandler handler;
+    TextParser parser;
+    handler.parser = &parser;
+    parser.setFileType(type);
+    parser.setLineSource(&text);
+    parser.setRegionHandler(&handler);
+    // the chunk, which is replayed when the parse is broken, is replayed to its end,
+    // the parse returns its last line and doesn't give the lines after it
+    int end = parser.parseParallel(0, 3000, 4);
+    CHECK(end >= 100);
+    CHECK(end < 2999);
+    CHECK(handler.last_line == end);
+  }
+}
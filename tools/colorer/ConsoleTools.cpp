@@ -9,6 +9,7 @@
 #include <colorer/viewer/ParsedLineWriter.h>
 #include <colorer/viewer/TextConsoleViewer.h>
 #include <colorer/xml/XmlParserErrorHandler.h>
+#include <algorithm>
 #include <ctime>
 #include <memory>
 #include <xercesc/dom/DOM.hpp>
@@ -240,32 +241,7 @@ FileType* ConsoleTools::selectType(HrcLibrary* hrcLibrary, LineSource* lineSourc
     }
   }
   if (typeDescription == nullptr || type == nullptr) {
-    UnicodeString textStart;
-    int totalLength = 0;
-    for (int i = 0; i < 4; i++) {
-      UnicodeString* iLine = lineSource->getLine(i);
-      if (iLine == nullptr) {
-        break;
-      }
-      textStart.append(*iLine);
-      textStart.append("\n");
-      totalLength += iLine->length();
-      if (totalLength > 500) {
-        break;
-      }
-    }
-
-    std::unique_ptr<UnicodeString> file_name;
-    if (inputFileName) {
-      UnicodeString fnpath(*inputFileName);
-      auto slash_idx = fnpath.lastIndexOf('\\');
-
-      if (slash_idx == -1) {
-        slash_idx = fnpath.lastIndexOf('/');
-      }
-      file_name = std::make_unique<UnicodeString>(fnpath, slash_idx + 1);
-    }
-    type = hrcLibrary->chooseFileType(file_name.get(), &textStart, 0);
+    type = hrcLibrary->chooseFileTypeOf(inputFileName.get(), lineSource);
   }
   return type;
 }
@@ -300,6 +276,75 @@ void ConsoleTools::profile(int loopCount)
   printf("%ld\n", (msecs * 1000) / CLOCKS_PER_SEC);
 }
 
+void ConsoleTools::genNative(int count)
+{
+  ParserFactory pf;
+  pf.loadCatalog(catalogPath.get());
+  TextLinesStore textLinesStore;
+  textLinesStore.loadFile(inputFileName.get(), true);
+  BaseEditor baseEditor(&pf, &textLinesStore);
+  auto& hrcLibrary = pf.getHrcLibrary();
+  FileType* type = selectType(&hrcLibrary, &textLinesStore);
+  type->getBaseScheme();
+  baseEditor.setFileType(type);
+
+  RegExpProfile profile;
+  baseEditor.setRegExpProfile(&profile);
+  baseEditor.lineCountEvent((int) textLinesStore.getLineCount());
+  baseEditor.validate(-1, false);
+  baseEditor.setRegExpProfile(nullptr);
+
+  std::vector<std::pair<const CRegExp*, SRegExpStat>> stats(profile.stats.begin(), profile.stats.end());
+  std::sort(stats.begin(), stats.end(),
+            [](const auto& a, const auto& b) { return a.second.nanoseconds > b.second.nanoseconds; });
+
+  std::string code =
+      "// Matchers of the regexps, generated by 'colorer -g'.\n"
+      "// Compiled into the application, they are registered at the static initialization.\n"
+      "#include <unicode/ustring.h>\n"
+      "#include \"colorer/common/UStr.h\"\n"
+      "#include \"colorer/cregexp/cregexp.h\"\n\n";
+  int generated = 0;
+  for (const auto& stat : stats) {
+    if (generated == count) {
+      break;
+    }
+    // block end regexps depend on the start, only start regexps are replaced
+    const UnicodeString* pattern = hrcLibrary.getRegExpPattern(stat.first);
+    std::string name = "colorer_native_" + std::to_string(generated);
+    if (pattern == nullptr || !stat.first->generateNative(code, name)) {
+      continue;
+    }
+    code += "static const UChar " + name + "_pattern[] = {";
+    for (int i = 0; i < pattern->length(); i++) {
+      char buf[16];
+      snprintf(buf, sizeof(buf), "%s0x%X", i ? ", " : "", (*pattern)[i]);
+      code += buf;
+    }
+    code += "};\n";
+    code += "[[maybe_unused]] static const bool " + name + "_registered = CRegExp::registerNative(\n    icu::UnicodeString(" +
+            name + "_pattern, " + std::to_string(pattern->length()) + "), " + name + ");\n\n";
+    fprintf(stderr, "%s: %u calls, %llu us\n", name.c_str(), stat.second.calls,
+            (unsigned long long) stat.second.nanoseconds / 1000);
+    generated++;
+  }
+
+  std::unique_ptr<Writer> writer;
+  try {
+    if (outputFileName != nullptr) {
+      writer = std::make_unique<FileWriter>(outputFileName.get(), false);
+    }
+    else {
+      writer = std::make_unique<StreamWriter>(stdout, false);
+    }
+  } catch (Exception& e) {
+    fprintf(stderr, "can't open file '%s' for writing:\n", UStr::to_stdstr(outputFileName.get()).c_str());
+    fprintf(stderr, "%s", e.what());
+    return;
+  }
+  writer->write(UnicodeString(code.c_str()));
+}
+
 void ConsoleTools::viewFile()
 {
   try {
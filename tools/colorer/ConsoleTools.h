@@ -82,6 +82,14 @@ class ConsoleTools
   */
   void profile(int loopCount);
 
+  /** Runs parser in profile mode and generates C++ code of the matchers
+      for the most expensive start regexps, see CRegExp::generateNative.
+      Generated file is compiled into the application to use the matchers.
+
+      @param count Number of regexps to generate the matchers for.
+  */
+  void genNative(int count);
+
   /** Lists all available HRC types and
       optionally tries to load them.
   */
@@ -7,7 +7,7 @@
 #include "ConsoleTools.h"
 
 /** Internal run action type */
-enum class JobType { JT_NOTHING, JT_REGTEST, JT_PROFILE, JT_LIST_LOAD, JT_LIST_TYPES, JT_LIST_TYPE_NAMES, JT_VIEW, JT_GEN, JT_GEN_TOKENS, JT_FORWARD };
+enum class JobType { JT_NOTHING, JT_REGTEST, JT_PROFILE, JT_LIST_LOAD, JT_LIST_TYPES, JT_LIST_TYPE_NAMES, JT_VIEW, JT_GEN, JT_GEN_TOKENS, JT_FORWARD, JT_GEN_NATIVE };
 
 struct setting
 {
@@ -22,6 +22,7 @@ struct setting
   std::string log_file_dir = ".";
   std::string log_level = "off";
   int profile_loops = 1;
+  int native_count = 20;
   bool line_numbers = false;
   bool copyright = true;
   bool bom_output = true;
@@ -45,6 +46,13 @@ void readArgs(int argc, char* argv[])
       }
       continue;
     }
+    if (argv[i][1] == 'g') {
+      settings.job = JobType::JT_GEN_NATIVE;
+      if (argv[i][2]) {
+        settings.native_count = atoi(argv[i] + 2);
+      }
+      continue;
+    }
     if (argv[i][1] == 'r') {
       settings.job = JobType::JT_REGTEST;
       continue;
@@ -192,6 +200,7 @@ void printUsage()
           "  -v         Runs viewer on file <fname> (uses 'console' hrd class)\n"
           "  -p<n>      Runs parser in profile mode (if <n> specified, makes <n> loops)\n"
           "  -f         Forwards input file into output with specified encodings\n"
+          "  -g<n>      Generates C++ matchers of <n> most expensive regexps of <filename> parsing\n"
           " Parameters:\n"
           "  -c<path>   Uses specified 'catalog.xml' file\n"
           "  -i<name>   Loads specified hrd rules from catalog\n"
@@ -271,6 +280,9 @@ int workIt()
       case JobType::JT_FORWARD:
         ct.forward();
         break;
+      case JobType::JT_GEN_NATIVE:
+        ct.genNative(settings.native_count);
+        break;
       default:
         printUsage();
         break;